@@ -7,9 +7,9 @@
 #include <chrono>
 #include <functional>
 #include <memory>
-#include <unordered_map>
-#include <unordered_set>
 #include <numeric>
+#include <algorithm>
+#include <cstdint>
 
 /*************
  * Setup code
@@ -73,141 +73,194 @@ int main(int argc, char const *argv[])
  *              Solutions
  ************************************/
 
-inline bool indexOutOfBounds(const int row,const int col,const int rows,const int cols)
-{
-    return row < 0 || row >= rows || col < 0 || col >= cols;
-}
+/*
+ * Every row of the schematic is classified once into bit masks (one bit per
+ * column, split into 64-bit words). Symbol masks are dilated by one cell in
+ * every direction with shifts and ORs, so a number is a part number if its
+ * digit span intersects the dilated mask of its own row.
+ */
 
-bool hasAdjacentSymbol(const std::vector<std::string> &lines, int i, int j)
-{
+using mask_word_t = uint64_t;
+constexpr int MASK_WORD_BITS = 64;
 
-    int rows = lines.size();
-    int cols = lines[0].size();
+struct Schematic
+{
+    int rows = 0;
+    int cols = 0;
+    int words = 0;
+    std::vector<std::string> lines;
+    std::vector<mask_word_t> digits;
+    std::vector<mask_word_t> symbols;
+    std::vector<mask_word_t> stars;
+    std::vector<mask_word_t> near_symbol;
+    std::vector<int> star_ids;
+    int star_count = 0;
+
+    const mask_word_t *row(const std::vector<mask_word_t> &masks, int r) const { return masks.data() + r * words; }
+};
 
-    for (int h = -1; h <= 1; ++h)
+// Returns the first column >= from whose bit equals value, or end if none
+int nextBit(const mask_word_t *row, int from, int end, bool value)
+{
+    while (from < end)
     {
-        for (int l = -1; l <= 1; ++l)
-        {
-            int row = i + h;
-            int col = j + l;
-            if (indexOutOfBounds(row, col, rows, cols))
-                continue;
-            char current_char = lines[row][col];
-            if (std::isdigit(current_char) || current_char == '.')
-                continue;
-            return true;
-        }
+        int word = from / MASK_WORD_BITS;
+        int offset = from % MASK_WORD_BITS;
+        mask_word_t bits = (value ? row[word] : ~row[word]) >> offset;
+        if (bits)
+            return std::min(end, from + __builtin_ctzll(bits));
+        from += MASK_WORD_BITS - offset;
     }
-
-    return false;
+    return end;
 }
 
-std::vector<int> idxAdjacentStars(const std::vector<std::string> &lines, int i, int j)
+bool anyBitInRange(const mask_word_t *row, int begin, int end)
 {
+    return nextBit(row, begin, end, true) < end;
+}
 
-    int rows = lines.size();
-    int cols = lines[0].size();
-    std::vector<int> v;
-
-    for (int h = -1; h <= 1; ++h)
+// Classifies up to 64 bytes at once; the loop is branch free so it vectorizes
+void classifyChunk(const char *chars, int count, mask_word_t &digits, mask_word_t &symbols, mask_word_t &stars)
+{
+    digits = symbols = stars = 0;
+    for (int b = 0; b < count; ++b)
     {
-        for (int l = -1; l <= 1; ++l)
-        {
-            int row = i + h;
-            int col = j + l;
-            if (indexOutOfBounds(row, col, rows, cols))
-                continue;
-            char current_char = lines[row][col];
-            if (current_char == '*')
-                v.push_back(row * cols + col);
-        }
+        unsigned char c = chars[b];
+        mask_word_t is_digit = (unsigned char)(c - '0') < 10;
+        mask_word_t is_star = c == '*';
+        mask_word_t is_symbol = !is_digit & (c != '.');
+        digits |= is_digit << b;
+        symbols |= is_symbol << b;
+        stars |= is_star << b;
     }
-
-    return v;
 }
 
-void part1(std::stringstream &file_content)
+Schematic parseSchematic(std::stringstream &file_content)
 {
-
-    std::vector<std::string> lines;
+    Schematic schematic;
 
     for (std::string line; getline(file_content, line);)
-        lines.push_back(line + ".");
+    {
+        if (line.empty())
+            continue;
+        schematic.cols = std::max(schematic.cols, (int)line.size());
+        schematic.lines.push_back(line);
+    }
 
-    int rows = lines.size();
-    int cols = lines[0].size();
-    int sum = 0;
-    int current_parsed_number = 0;
-    int has_symbol_around = 0;
+    schematic.rows = schematic.lines.size();
+    schematic.words = (schematic.cols + MASK_WORD_BITS - 1) / MASK_WORD_BITS;
+    size_t mask_size = schematic.rows * schematic.words;
+    schematic.digits.assign(mask_size, 0);
+    schematic.symbols.assign(mask_size, 0);
+    schematic.stars.assign(mask_size, 0);
+    schematic.near_symbol.assign(mask_size, 0);
+    schematic.star_ids.assign(schematic.rows * schematic.cols, -1);
 
-    for (int row = 0; row < rows; row++)
+    for (int r = 0; r < schematic.rows; ++r)
     {
-        for (int col = 0; col < cols; col++)
+        const std::string &line = schematic.lines[r];
+        for (int w = 0; w < schematic.words; ++w)
         {
-            char current_char = lines[row][col];
-
-            if (std::isdigit(current_char))
-            {
-                current_parsed_number = current_parsed_number * 10 + (current_char - '0');
-                has_symbol_around |= hasAdjacentSymbol(lines, row, col);
-            }
-            else
-            {
-                if (has_symbol_around)
-                {
-                    sum += current_parsed_number;
-                }
-
-                current_parsed_number = 0;
-                has_symbol_around = 0;
-            }
+            int begin = w * MASK_WORD_BITS;
+            int count = std::max(0, std::min(MASK_WORD_BITS, (int)line.size() - begin));
+            size_t idx = r * schematic.words + w;
+            classifyChunk(line.data() + begin, count, schematic.digits[idx], schematic.symbols[idx], schematic.stars[idx]);
         }
-    }
 
-    std::cerr << "Part 1: " << sum << std::endl;
-}
+        const mask_word_t *star_row = schematic.row(schematic.stars, r);
+        for (int c = nextBit(star_row, 0, schematic.cols, true); c < schematic.cols; c = nextBit(star_row, c + 1, schematic.cols, true))
+            schematic.star_ids[r * schematic.cols + c] = schematic.star_count++;
+    }
 
-void part2(std::stringstream &file_content)
-{
-    std::vector<std::string> lines;
+    // Horizontal dilation, carrying bits across word boundaries
+    std::vector<mask_word_t> widened(mask_size, 0);
+    for (int r = 0; r < schematic.rows; ++r)
+    {
+        const mask_word_t *in = schematic.row(schematic.symbols, r);
+        mask_word_t *out = widened.data() + r * schematic.words;
+        for (int w = 0; w < schematic.words; ++w)
+        {
+            mask_word_t left_carry = w > 0 ? in[w - 1] >> (MASK_WORD_BITS - 1) : 0;
+            mask_word_t right_carry = w + 1 < schematic.words ? in[w + 1] << (MASK_WORD_BITS - 1) : 0;
+            out[w] = in[w] | (in[w] << 1) | left_carry | (in[w] >> 1) | right_carry;
+        }
+    }
 
-    for (std::string line; getline(file_content, line);)
-        lines.push_back(line + ".");
+    // Vertical dilation
+    for (int r = 0; r < schematic.rows; ++r)
+    {
+        mask_word_t *out = schematic.near_symbol.data() + r * schematic.words;
+        for (int dr = -1; dr <= 1; ++dr)
+        {
+            int source = r + dr;
+            if (source < 0 || source >= schematic.rows)
+                continue;
+            const mask_word_t *in = widened.data() + source * schematic.words;
+            for (int w = 0; w < schematic.words; ++w)
+                out[w] |= in[w];
+        }
+    }
 
-    int rows = lines.size();
-    int cols = lines[0].size();
-    std::unordered_map<int, std::vector<int>> numbers_adjacent_to_star;
-    int current_parsed_number = 0;
-    std::unordered_set<int> stars_adjacent_to_number;
+    return schematic;
+}
 
-    for (int row = 0; row < rows; row++)
+// Calls callback(row, begin, end, value) for every number span of the schematic
+template <typename Callback>
+void forEachNumber(const Schematic &schematic, Callback callback)
+{
+    for (int r = 0; r < schematic.rows; ++r)
     {
-        for (int col = 0; col < cols; col++)
+        const mask_word_t *digit_row = schematic.row(schematic.digits, r);
+        const std::string &line = schematic.lines[r];
+        for (int begin = nextBit(digit_row, 0, schematic.cols, true); begin < schematic.cols;)
         {
-            char current_char = lines[row][col];
-
-            if (std::isdigit(current_char))
-            {
-                current_parsed_number = current_parsed_number * 10 + (current_char - '0');
-                std::vector<int> stars = idxAdjacentStars(lines, row, col);
-                stars_adjacent_to_number.insert(stars.begin(), stars.end());
-            }
-            else
-            {
-                if (stars_adjacent_to_number.size() > 0)
-                {
-                    for (int star : stars_adjacent_to_number)
-                        numbers_adjacent_to_star[star].push_back(current_parsed_number);
-                }
-
-                current_parsed_number = 0;
-                stars_adjacent_to_number.clear();
-            }
+            int end = nextBit(digit_row, begin, schematic.cols, false);
+            int value = 0;
+            for (int c = begin; c < end; ++c)
+                value = value * 10 + (line[c] - '0');
+            callback(r, begin, end, value);
+            begin = nextBit(digit_row, end, schematic.cols, true);
         }
     }
+}
 
-    int totalsum = std::accumulate(numbers_adjacent_to_star.begin(), numbers_adjacent_to_star.end(), 0, [](unsigned long long sum, std::pair<int, std::vector<int>> pair)
-                                   { return sum + (pair.second.size() != 2 ? 0 : pair.second[0] * pair.second[1]); });
+void part1(std::stringstream &file_content)
+{
+    Schematic schematic = parseSchematic(file_content);
+    long long sum = 0;
+
+    forEachNumber(schematic, [&](int row, int begin, int end, int value)
+                  {
+                      if (anyBitInRange(schematic.row(schematic.near_symbol, row), begin, end))
+                          sum += value; });
+
+    std::cerr << "Part 1: " << sum << std::endl;
+}
+
+void part2(std::stringstream &file_content)
+{
+    Schematic schematic = parseSchematic(file_content);
+    std::vector<int> star_number_count(schematic.star_count, 0);
+    std::vector<long long> star_ratio(schematic.star_count, 1);
+
+    forEachNumber(schematic, [&](int row, int begin, int end, int value)
+                  {
+                      int first_col = std::max(0, begin - 1);
+                      int last_col = std::min(schematic.cols, end + 1);
+                      for (int r = std::max(0, row - 1); r <= std::min(schematic.rows - 1, row + 1); ++r)
+                      {
+                          const mask_word_t *star_row = schematic.row(schematic.stars, r);
+                          for (int c = nextBit(star_row, first_col, last_col, true); c < last_col; c = nextBit(star_row, c + 1, last_col, true))
+                          {
+                              int id = schematic.star_ids[r * schematic.cols + c];
+                              if (++star_number_count[id] <= 2)
+                                  star_ratio[id] *= value;
+                          }
+                      } });
+
+    long long totalsum = 0;
+    for (int id = 0; id < schematic.star_count; ++id)
+        totalsum += star_number_count[id] == 2 ? star_ratio[id] : 0;
 
     std::cerr << "Part 2: " << totalsum << std::endl;
-}
\ No newline at end of file
+}
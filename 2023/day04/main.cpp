@@ -9,6 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -72,40 +74,86 @@ int main(int argc, char const *argv[])
  *              Solutions
  ************************************/
 
-void part1(std::stringstream &file_content)
+/*
+ * Card numbers are below 128 in practice, so each side of a card fits in a
+ * 128-bit mask split over two words. Larger numbers spill into a wider mask
+ * that is only allocated when one shows up. The match count is the popcount
+ * of their AND.
+ */
+
+struct card_mask_t
 {
-    int total_points = 0;
+    uint64_t low = 0;
+    uint64_t high = 0;
+    std::vector<uint64_t> wide;
 
-    for (std::string card_line; std::getline(file_content, card_line);)
+    void set(int value)
     {
+        if (value < 64)
+            low |= uint64_t(1) << value;
+        else if (value < 128)
+            high |= uint64_t(1) << (value - 64);
+        else
+        {
+            size_t word = (value - 128) / 64;
+            if (word >= wide.size())
+                wide.resize(word + 1, 0);
+            wide[word] |= uint64_t(1) << (value % 64);
+        }
+    }
+};
 
-        bool winning_set[100] = {0};
-        bool winning_set_done = false;
-        int winning_points = 0;
-        std::stringstream current_line_stream(card_line);
+inline int countMatches(const card_mask_t &winning, const card_mask_t &owned)
+{
+    int matches = __builtin_popcountll(winning.low & owned.low) + __builtin_popcountll(winning.high & owned.high);
+    for (size_t w = 0; w < std::min(winning.wide.size(), owned.wide.size()); ++w)
+        matches += __builtin_popcountll(winning.wide[w] & owned.wide[w]);
+    return matches;
+}
+
+int parseCardMatches(const std::string &card_line)
+{
+    card_mask_t masks[2];
+    int side = 0;
+    int value = -1;
 
-        for (std::string current_word = ""; current_line_stream >> current_word;)
+    size_t pos = card_line.find(':');
+    for (pos = pos == std::string::npos ? 0 : pos + 1; pos <= card_line.size(); ++pos)
+    {
+        char c = pos < card_line.size() ? card_line[pos] : ' ';
+        if (c >= '0' && c <= '9')
         {
-            if (current_word[0] == '|')
-            {
-                winning_set_done = true;
-            }
-            if (!std::isdigit(current_word.back()))
-                continue;
-
-            int value = std::stoi(current_word);
-
-            if (!winning_set_done)
-            {
-                winning_set[value] = true;
-            }
-            else if (winning_set[value])
-            {
-                winning_points++;
-            }
+            value = (value < 0 ? 0 : value * 10) + (c - '0');
+            continue;
         }
+        if (value >= 0)
+            masks[side].set(value);
+        value = -1;
+        if (c == '|')
+            side = 1;
+    }
 
-        total_points += winning_points ? 1 << (winning_points - 1) : 0;
+    return countMatches(masks[0], masks[1]);
+}
+
+void part1(std::stringstream &file_content)
+{
+    uint64_t total_points = 0;
+
+    for (std::string card_line; std::getline(file_content, card_line);)
+    {
+        if (card_line.empty())
+            continue;
+        int winning_points = parseCardMatches(card_line);
+        if (!winning_points)
+            continue;
+
+        // A card is worth 2^(matches - 1); totals past 64 bits are rejected
+        if (winning_points > 64 || __builtin_add_overflow(total_points, uint64_t(1) << (winning_points - 1), &total_points))
+        {
+            std::cerr << "Part 1 points do not fit in 64 bits" << std::endl;
+            return;
+        }
     }
 
     std::cout << total_points << std::endl;
@@ -113,49 +161,30 @@ void part1(std::stringstream &file_content)
 
 void part2(std::stringstream &file_content)
 {
-
-    int total_scratchcards = 0;
-    int cards_count_map[300] = {0};
+    // Won copies are added to a range of following cards through a difference
+    // array, so every card is touched once whatever the deck size
+    long long total_scratchcards = 0;
+    long long running_copies = 0;
+    std::vector<long long> copies_delta;
+    size_t current_card = 0;
 
     for (std::string card_line; std::getline(file_content, card_line);)
     {
+        if (card_line.empty())
+            continue;
 
-        bool winning_set[100] = {0};
-        bool winning_set_done = false;
-        std::stringstream current_line_stream(card_line);
+        int matches = parseCardMatches(card_line);
+        if (copies_delta.size() < current_card + matches + 2)
+            copies_delta.resize(std::max(copies_delta.size() * 2, current_card + matches + 2), 0);
 
-        int winning_card_count = 0;
-        int current_card = 0;
+        running_copies += copies_delta[current_card];
+        long long card_count = running_copies + 1;
+        total_scratchcards += card_count;
 
-        for (std::string current_word = ""; current_line_stream >> current_word;)
-        {
-            if (current_word.back() == ':')
-            {
-                current_card = std::stoi(current_word);
-                cards_count_map[current_card]++;
-                total_scratchcards++;
-            }
-            if (current_word[0] == '|')
-            {
-                winning_set_done = true;
-            }
-            if (!std::isdigit(current_word.back()))
-                continue;
-
-            int value = std::stoi(current_word);
-
-            if (!winning_set_done)
-            {
-                winning_set[value] = true;
-            }
-            else if (winning_set[value])
-            {
-                winning_card_count = winning_card_count ? winning_card_count + 1 : current_card + 1;
-                cards_count_map[winning_card_count] += cards_count_map[current_card];
-                total_scratchcards += cards_count_map[current_card];
-            }
-        }
+        copies_delta[current_card + 1] += card_count;
+        copies_delta[current_card + matches + 1] -= card_count;
+        current_card++;
     }
 
     std::cout << total_scratchcards << std::endl;
-}
\ No newline at end of file
+}
@@ -10,6 +10,8 @@
 #include <numeric>
 #include <cstring>
 #include <climits>
+#include <algorithm>
+#include <array>
 
 /*************
  * Setup code
@@ -138,83 +140,144 @@ std::pair<RangeMaps, std::vector<valuesize>> parseInput(std::stringstream &file_
     return std::make_pair(value_range_maps, seeds);
 }
 
-bool isOverlapping(const range &rangeA, const range &rangeB)
+/*
+ * Every stage is a piecewise-linear function over the whole value domain:
+ * piece i covers [starts[i], starts[i + 1] - 1] and maps v to v + offsets[i]
+ * (offsets use unsigned wrap-around). The seven stages are composed once into
+ * a single function from seed to location.
+ */
+struct PiecewiseLinear
 {
-    return !(rangeA.second < rangeB.first || rangeA.first > rangeB.second);
-}
+    std::vector<valuesize> starts;
+    std::vector<valuesize> offsets;
 
-bool isWithinRange(const valuesize value, const range &range)
-{
-    return value >= range.first && value <= range.second;
-}
+    void append(valuesize start, valuesize offset)
+    {
+        if (!starts.empty() && offsets.back() == offset)
+            return;
+        if (!starts.empty() && starts.back() == start)
+        {
+            offsets.back() = offset;
+            return;
+        }
+        starts.push_back(start);
+        offsets.push_back(offset);
+    }
 
-valuesize getLocationFromSeed(const valuesize &seed, const RangeMaps &value_range_maps, const int index)
-{
-    if (index == LOCATION_IDX)
-        return seed;
+    valuesize pieceEnd(size_t i) const
+    {
+        return i + 1 < starts.size() ? starts[i + 1] - 1 : ULLONG_MAX;
+    }
 
-    for (const auto &value_range : value_range_maps[index])
+    // Branchless binary search, starts[0] is always 0
+    size_t pieceIndex(valuesize value) const
     {
-        if (isWithinRange(seed, value_range.source))
-            return getLocationFromSeed(seed - value_range.source.first + value_range.destination.first, value_range_maps, index + 1);
+        const valuesize *base = starts.data();
+        size_t n = starts.size();
+        while (n > 1)
+        {
+            size_t half = n / 2;
+            base = base[half] <= value ? base + half : base;
+            n -= half;
+        }
+        return base - starts.data();
     }
 
-    return getLocationFromSeed(seed, value_range_maps, index + 1);
-}
+    valuesize operator()(valuesize value) const
+    {
+        return value + offsets[pieceIndex(value)];
+    }
+};
 
-void part1(std::stringstream &file_content)
+PiecewiseLinear makeStageFunction(std::vector<RangeMap> range_maps)
 {
-    valuesize min = ULLONG_MAX;
-    auto [value_range_maps, seeds] = parseInput(file_content);
+    std::sort(range_maps.begin(), range_maps.end(), [](const RangeMap &a, const RangeMap &b)
+              { return a.source.first < b.source.first; });
 
-    for (auto seed : seeds)
-        min = std::min(min, getLocationFromSeed(seed, value_range_maps, 0));
+    PiecewiseLinear function;
+    valuesize next_start = 0;
 
-    std::cout << "Part 1 : " << min << std::endl;
+    for (const auto &range_map : range_maps)
+    {
+        if (range_map.source.first > next_start)
+            function.append(next_start, 0);
+        function.append(range_map.source.first, range_map.destination.first - range_map.source.first);
+        next_start = range_map.source.second + 1;
+    }
+    function.append(next_start, 0);
+
+    return function;
 }
 
-valuesize getMinFromRange(const range &initial_seed, const RangeMaps &value_range_maps, const int index, const int range_index = 0)
+// Returns second(first(v))
+PiecewiseLinear compose(const PiecewiseLinear &first, const PiecewiseLinear &second)
 {
-    if (index == LOCATION_IDX)
-        return initial_seed.first;
+    PiecewiseLinear function;
 
-    for (int i = range_index, value_range_size = value_range_maps[index].size(); i < value_range_size; ++i)
+    for (size_t i = 0; i < first.starts.size(); ++i)
     {
-        const auto &value_range = value_range_maps[index][i];
-        if (isOverlapping(initial_seed, value_range.source))
+        valuesize offset = first.offsets[i];
+        valuesize image_begin = first.starts[i] + offset;
+        valuesize image_end = first.pieceEnd(i) + offset;
+
+        for (size_t j = second.pieceIndex(image_begin); j < second.starts.size() && second.starts[j] <= image_end; ++j)
         {
-            valuesize min = ULLONG_MAX;
+            valuesize begin = std::max(image_begin, second.starts[j]);
+            function.append(begin - offset, offset + second.offsets[j]);
+        }
+    }
 
-            range overlapping_seed = {
-                std::max(initial_seed.first, value_range.source.first) - value_range.source.first + value_range.destination.first,
-                std::min(initial_seed.second, value_range.source.second) - value_range.source.first + value_range.destination.first};
-            min = std::min(min, getMinFromRange(overlapping_seed, value_range_maps, index + 1, 0));
+    return function;
+}
+
+PiecewiseLinear composeStages(const RangeMaps &value_range_maps)
+{
+    PiecewiseLinear function = makeStageFunction(value_range_maps[0]);
+    for (int index = 1; index < LOCATION_IDX; ++index)
+        function = compose(function, makeStageFunction(value_range_maps[index]));
+    return function;
+}
 
-            if (initial_seed.second > value_range.source.second)
-                min = std::min(min, getMinFromRange({value_range.source.second + 1, initial_seed.second}, value_range_maps, index, i + 1));
+// The function increases within a piece, so the minimum of a range is reached
+// at the range start or at the start of a piece. Ranges are swept in order
+// alongside the pieces.
+valuesize minOverRanges(const PiecewiseLinear &function, std::vector<range> ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+    valuesize min = ULLONG_MAX;
+    size_t first_piece = 0;
 
-            if (initial_seed.first < value_range.source.first)
-                min = std::min(min, getMinFromRange({initial_seed.first, value_range.source.first - 1}, value_range_maps, index + 1, 0));
+    for (const auto &seed_range : ranges)
+    {
+        while (first_piece + 1 < function.starts.size() && function.starts[first_piece + 1] <= seed_range.first)
+            first_piece++;
 
-            return min;
-        }
+        for (size_t i = first_piece; i < function.starts.size() && function.starts[i] <= seed_range.second; ++i)
+            min = std::min(min, std::max(seed_range.first, function.starts[i]) + function.offsets[i]);
     }
 
-    return getMinFromRange(initial_seed, value_range_maps, index + 1, 0);
+    return min;
 }
 
-void part2(std::stringstream &file_content)
+void part1(std::stringstream &file_content)
 {
     valuesize min = ULLONG_MAX;
     auto [value_range_maps, seeds] = parseInput(file_content);
-    std::vector<range> seed_ranges;
-    for (size_t i = 0; i < seeds.size(); i += 2)
-        seed_ranges.push_back({seeds[i], seeds[i] + seeds[i + 1] - 1});
+    PiecewiseLinear seed_to_location = composeStages(value_range_maps);
 
-    for (auto seed_range : seed_ranges)
-        min = std::min(min, getMinFromRange(seed_range, value_range_maps, 0, 0));
+    for (auto seed : seeds)
+        min = std::min(min, seed_to_location(seed));
 
-    std::cout << "Part 2 : " << min << std::endl;
+    std::cout << "Part 1 : " << min << std::endl;
 }
 
-// g++ -g -O3 -Wall -Werror -fsanitize=address -fno-omit-frame-pointer -std=c++17 main.cpp -o app
\ No newline at end of file
+void part2(std::stringstream &file_content)
+{
+    auto [value_range_maps, seeds] = parseInput(file_content);
+    PiecewiseLinear seed_to_location = composeStages(value_range_maps);
+    std::vector<range> seed_ranges;
+    for (size_t i = 0; i + 1 < seeds.size(); i += 2)
+        seed_ranges.push_back({seeds[i], seeds[i] + seeds[i + 1] - 1});
+
+    std::cout << "Part 2 : " << minOverRanges(seed_to_location, seed_ranges) << std::endl;
+}
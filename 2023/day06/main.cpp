@@ -11,6 +11,7 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <cstdint>
 
 /*************
  * Setup code
@@ -74,88 +75,110 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-std::vector<std::pair<int, int>> parseInput(std::stringstream &file_content)
-{
-    std::vector<std::pair<int, int>> result;
-    std::string line;
-    std::string num;
+/**
+ * Records grow with the square of the race time, so values are kept in
+ * 128 bits to stay exact for long races.
+ */
+using race_value_t = __int128;
 
-    {
-        std::getline(file_content, line);
-        std::stringstream ss(line);
-        ss >> num;
+/**
+ * Races in structure-of-arrays form, so the batch solver runs over plain
+ * contiguous arrays.
+ */
+struct RaceBatch
+{
+    std::vector<race_value_t> times;
+    std::vector<race_value_t> records;
+};
 
-        while (ss >> num)
-        {
-            int time = std::stoi(num);
-            result.push_back(std::make_pair(time, 0));
-        }
-    }
+/**
+ * Parses the "Time:" and "Distance:" lines. When join_digits is set, the
+ * spaces are ignored and each line is read as a single number (part 2).
+ */
+RaceBatch parseInput(std::stringstream &file_content, bool join_digits)
+{
+    RaceBatch races;
+    std::vector<race_value_t> *targets[2] = {&races.times, &races.records};
 
+    std::string line;
+    for (int line_idx = 0; line_idx < 2 && std::getline(file_content, line); ++line_idx)
     {
-        std::getline(file_content, line);
-        std::stringstream ss(line);
-        int count = 0;
-        ss >> num;
+        std::vector<race_value_t> &target = *targets[line_idx];
+        bool in_number = false;
 
-        while (ss >> num)
+        for (char c : line)
         {
-            int duration = std::stoi(num);
-            result[count++].second = duration;
+            if (c < '0' || c > '9')
+            {
+                in_number = in_number && join_digits;
+                continue;
+            }
+            if (!in_number)
+                target.push_back(0);
+            in_number = true;
+            target.back() = target.back() * 10 + (c - '0');
         }
     }
 
-    return result;
+    return races;
 }
 
 /**
- * Solves a quadratic equation of the form ax^2 + bx + c = 0.
+ * Integer square root: the largest r such that r * r <= n.
+ * The floating point estimate is corrected to the exact value.
+ */
+unsigned __int128 isqrt(unsigned __int128 n)
+{
+    unsigned __int128 r = (unsigned __int128)std::sqrt((long double)n);
+    while (r > 0 && r * r > n)
+        --r;
+    while ((r + 1) * (r + 1) <= n)
+        ++r;
+    return r;
+}
+
+/**
+ * Counts the hold times h in [0, time] with h * (time - h) > record.
  *
- * @param a The coefficient of x^2.
- * @param b The coefficient of x.
- * @param c The constant term.
- * @return A pair of roots (x1, x2) of the quadratic equation, sorted in descending order.
+ * This is (2h - time)^2 < time^2 - 4 * record, so 2h - time ranges over the
+ * integers of [-s, s] sharing the parity of time, with s = isqrt(delta - 1).
  */
-std::pair<double, double> solveQuadraticEquation(const double a, const double b, const double c)
+uint64_t waysToWin(race_value_t time, race_value_t record)
 {
-    double delta = b * b - 4 * a * c;
-    double x1 = (-b + sqrt(delta)) / (2 * a);
-    double x2 = (-b - sqrt(delta)) / (2 * a);
+    race_value_t delta = time * time - 4 * record;
+    if (delta <= 0)
+        return 0;
 
-    return x1 > x2 ? std::make_pair(x1, x2) : std::make_pair(x2, x1);
+    unsigned __int128 s = isqrt((unsigned __int128)(delta - 1));
+    return (uint64_t)(s + ((s & 1) == (unsigned __int128)(time & 1) ? 1 : 0));
 }
 
-void part1(std::stringstream &file_content)
+/**
+ * Solves every race of the batch and returns the product of the ways to win.
+ */
+uint64_t waysToWinProduct(const RaceBatch &races, std::vector<uint64_t> &ways)
 {
+    size_t count = std::min(races.times.size(), races.records.size());
+    ways.resize(count);
 
-    auto time_record_list = parseInput(file_content);
-    int total = 1;
-    for (const auto &[time, record] : time_record_list)
-    {
-        auto [x1, x2] = solveQuadraticEquation(-1, time, -record);
-        total *= (int(x1 - .1) - (int)(x2 + 1.1) + 1);
-    }
+    for (size_t i = 0; i < count; ++i)
+        ways[i] = waysToWin(races.times[i], races.records[i]);
 
-    std::cout << "Part 1: " << total << std::endl;
+    return std::accumulate(ways.begin(), ways.end(), uint64_t(1), std::multiplies<uint64_t>());
 }
 
-void part2(std::stringstream &file_content)
+void part1(std::stringstream &file_content)
 {
-    auto time_record_list = parseInput(file_content);
-
-    int total = 1;
-
-    std::string time_s = "";
-    std::string record_s = "";
+    std::vector<uint64_t> ways;
+    uint64_t total = waysToWinProduct(parseInput(file_content, false), ways);
 
-    for (const auto &[time, record] : time_record_list)
-    {
-        time_s += std::to_string(time);
-        record_s += std::to_string(record);
-    }
+    std::cout << "Part 1: " << total << std::endl;
+}
 
-    auto [x1, x2] = solveQuadraticEquation(-1, std::stod(time_s), -std::stod(record_s));
-    total *= (int(x1 - .1) - int(x2 + 1.1) + 1);
+void part2(std::stringstream &file_content)
+{
+    std::vector<uint64_t> ways;
+    uint64_t total = waysToWinProduct(parseInput(file_content, true), ways);
 
     std::cout << "Part 2: " << total << std::endl;
 }
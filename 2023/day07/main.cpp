@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <array>
+#include <cstdint>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -129,92 +132,115 @@ HandType getHandType(int max_occurence, int different_cards)
     return HandType::None;
 }
 
-int valueCmp(const std::string &a, const std::string &b, std::unordered_map<char, int> &cardValues)
+/*
+ * A hand is packed into a 32-bit key that sorts like the hand: the type in
+ * bits 20-23, then the five card ranks as 4-bit digits, first card highest.
+ * Rank 0 is reserved for the joker.
+ */
+using card_ranks_t = std::array<uint8_t, 256>;
+
+constexpr card_ranks_t makeCardRanks(bool joker)
 {
-    for (size_t i = 0; i < a.size(); i++)
-    {
-        if (cardValues[a[i]] < cardValues[b[i]])
-            return -1;
-        else if (cardValues[a[i]] > cardValues[b[i]])
-            return 1;
-    }
-    return 0;
+    card_ranks_t ranks{};
+    const char order[] = "23456789TJQKA";
+    for (int i = 0; i < 13; ++i)
+        ranks[(unsigned char)order[i]] = i + 1;
+    if (joker)
+        ranks['J'] = 0;
+    return ranks;
 }
 
-std::vector<std::tuple<std::string, int, int, int, int>> parsInput(std::stringstream &file_content)
+constexpr card_ranks_t CARD_RANKS = makeCardRanks(false);
+constexpr card_ranks_t CARD_RANKS_JOKER = makeCardRanks(true);
+
+struct hand_bid_t
 {
-    std::vector<std::tuple<std::string, int, int, int, int>> result;
-    std::string line;
-    while (std::getline(file_content, line))
+    uint32_t key;
+    uint32_t bid;
+};
+
+uint32_t encodeHand(const char *hand, const card_ranks_t &ranks)
+{
+    uint8_t counts[16] = {0};
+    uint32_t key = 0;
+
+    for (int i = 0; i < 5; ++i)
     {
-        std::stringstream line_stream(line);
-        std::string hand_string;
-        int value;
-        int different_card = 0;
-        int max_occurence = 0;
-        int jcount = 0;
-        std::unordered_map<char, int> valcount;
-
-        line_stream >> hand_string >> value;
-        for (auto c : hand_string)
-        {
-            if (c == 'J')
-            {
-                jcount++;
-                continue;
-            }
-            if (valcount[c] == 0)
-                different_card++;
-            valcount[c]++;
-            max_occurence = std::max(max_occurence, valcount[c]);
-        }
-
-        result.push_back({hand_string, value, different_card, jcount, max_occurence});
+        uint8_t rank = ranks[(unsigned char)hand[i]];
+        counts[rank]++;
+        key = (key << 4) | rank;
+    }
+
+    // Jokers join the most frequent card, in part 1 no card has rank 0
+    int jokers = counts[0];
+    int different_cards = 0;
+    int max_occurence = 0;
+    for (int rank = 1; rank < 16; ++rank)
+    {
+        different_cards += counts[rank] != 0;
+        max_occurence = std::max<int>(max_occurence, counts[rank]);
     }
-    return result;
-}
 
-#define D_HAND_TYPE 0
-#define D_HAND_STRING 1
-#define D_VALUE 2
+    HandType hand_type = getHandType(max_occurence + jokers, different_cards);
+    return ((uint32_t)hand_type << 20) | key;
+}
 
-std::string part1(std::stringstream &file_content)
+std::vector<hand_bid_t> parseInput(std::stringstream &file_content, const card_ranks_t &ranks)
 {
-    std::unordered_map<char, int> cardValues = {
-        {'2', 0}, {'3', 1}, {'4', 2}, {'5', 3}, {'6', 4}, {'7', 5}, {'8', 6}, {'9', 7}, {'T', 8}, {'J', 9}, {'Q', 10}, {'K', 11}, {'A', 12}};
-
-    auto parseResultList = parsInput(file_content);
-    std::vector<std::tuple<HandType, std::string, int>> list_hand_bid;
-
-    for (const auto &[hand_string, value, different, jcount, max] : parseResultList)
-        list_hand_bid.push_back({getHandType(std::max(max, jcount), different + (jcount != 0)), hand_string, value});
-
-    std::sort(list_hand_bid.begin(), list_hand_bid.end(), [&](const auto &a, const auto &b)
-              { return (std::get<D_HAND_TYPE>(a) == std::get<D_HAND_TYPE>(b)) ? valueCmp(std::get<D_HAND_STRING>(a), std::get<D_HAND_STRING>(b), cardValues) < 0 : std::get<D_HAND_TYPE>(a) < std::get<D_HAND_TYPE>(b); });
-    
-    int result = 0, k = 1;
-    for (const auto &a : list_hand_bid)
-        result += (k++) * std::get<D_VALUE>(a);
-    return std::to_string(result);
+    std::vector<hand_bid_t> hands;
+
+    for (std::string line; std::getline(file_content, line);)
+    {
+        if (line.size() < 7)
+            continue;
+
+        uint32_t bid = 0;
+        for (size_t i = 6; i < line.size() && std::isdigit(line[i]); ++i)
+            bid = bid * 10 + (line[i] - '0');
+
+        hands.push_back({encodeHand(line.data(), ranks), bid});
+    }
+
+    return hands;
 }
 
-std::string part2(std::stringstream &file_content)
+/*
+ * LSD radix sort on the 24 significant bits of the keys, one stable counting
+ * pass per byte.
+ */
+void radixSortHands(std::vector<hand_bid_t> &hands)
 {
-    std::unordered_map<char, int> cardValues = {
-        {'2', 0}, {'3', 1}, {'4', 2}, {'5', 3}, {'6', 4}, {'7', 5}, {'8', 6}, {'9', 7}, {'T', 8}, {'J', -1}, {'Q', 10}, {'K', 11}, {'A', 12}};
+    std::vector<hand_bid_t> buffer(hands.size());
 
-    auto parseResultList = parsInput(file_content);
-    std::vector<std::tuple<HandType, std::string, int>> list_hand_bid;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        size_t offsets[257] = {0};
+        for (const auto &hand : hands)
+            offsets[((hand.key >> shift) & 0xFF) + 1]++;
+        for (int i = 0; i < 256; ++i)
+            offsets[i + 1] += offsets[i];
+        for (const auto &hand : hands)
+            buffer[offsets[(hand.key >> shift) & 0xFF]++] = hand;
+        hands.swap(buffer);
+    }
+}
 
-    for (const auto &[hand_string, value, different, jcount, max] : parseResultList)
-        list_hand_bid.push_back({getHandType(max + jcount, different), hand_string, value});
+uint64_t totalWinnings(std::vector<hand_bid_t> hands)
+{
+    radixSortHands(hands);
 
-    std::sort(list_hand_bid.begin(), list_hand_bid.end(), [&](const auto &a, const auto &b)
-              { return (std::get<D_HAND_TYPE>(a) == std::get<D_HAND_TYPE>(b)) ? valueCmp(std::get<D_HAND_STRING>(a), std::get<D_HAND_STRING>(b), cardValues) < 0 : std::get<D_HAND_TYPE>(a) < std::get<D_HAND_TYPE>(b); });
+    uint64_t result = 0, k = 1;
+    for (const auto &hand : hands)
+        result += (k++) * hand.bid;
+    return result;
+}
 
-    int result = 0, k = 1;
-    for (const auto &a : list_hand_bid)
-        result += (k++) * std::get<D_VALUE>(a);
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(totalWinnings(parseInput(file_content, CARD_RANKS)));
+}
 
-    return std::to_string(result);
+std::string part2(std::stringstream &file_content)
+{
+    return std::to_string(totalWinnings(parseInput(file_content, CARD_RANKS_JOKER)));
 }
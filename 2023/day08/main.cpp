@@ -11,8 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <future>
 
 /*************
  * Setup code
@@ -98,264 +99,318 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-struct Node
+/*
+ * Labels are interned into dense node ids. The instruction string is folded
+ * into one jump table (node -> node after a full pass), together with the
+ * offsets inside a pass where the walk stands on a target node. A ghost is
+ * then a sequence over pass boundaries: a tail of mu passes followed by a
+ * cycle of lambda passes, found with Brent's algorithm.
+ */
+
+using node_id_t = uint32_t;
+using step_t = __int128;
+
+constexpr int LABEL_BASE = 36;
+constexpr int LABEL_CODES = LABEL_BASE * LABEL_BASE * LABEL_BASE;
+constexpr node_id_t NO_NODE = UINT32_MAX;
+
+struct Graph
 {
-    std::string key;
-    Node *left;
-    Node *right;
+    std::string instructions;
+    std::vector<std::string> labels;
+    std::vector<node_id_t> left;
+    std::vector<node_id_t> right;
 };
 
-std::vector<std::vector<std::string>> parseInput(std::stringstream &file_content)
+struct PassTable
 {
-    std::vector<std::vector<std::string>> parsed_input;
-    std::string line;
-    while (std::getline(file_content, line))
-    {
+    std::vector<node_id_t> jump;
+    std::vector<uint32_t> hit_begin;
+    std::vector<uint32_t> hit_offsets;
+};
 
-        std::string currentString = "";
-        std::vector<std::string> currentLine;
-        for (char c : line)
-        {
-            if (std::isalnum(c))
-            {
-                currentString += c;
-            }
-            else if (currentString != "")
-            {
-                currentLine.push_back(currentString);
-                currentString = "";
-            }
-        }
+struct GhostCycle
+{
+    std::vector<node_id_t> path;
+    size_t mu = 0;
+    size_t lambda = 0;
+};
 
-        if (currentLine.size() > 0)
-        {
-            parsed_input.push_back(currentLine);
-        }
-    }
-    return parsed_input;
+inline int labelDigit(char c)
+{
+    return std::isdigit(c) ? c - '0' : 10 + (std::toupper(c) - 'A');
 }
 
-std::string part1(std::stringstream &file_content)
+node_id_t internLabel(Graph &graph, std::vector<node_id_t> &ids, const char *label)
 {
+    int code = (labelDigit(label[0]) * LABEL_BASE + labelDigit(label[1])) * LABEL_BASE + labelDigit(label[2]);
+    if (ids[code] == NO_NODE)
+    {
+        ids[code] = graph.labels.size();
+        graph.labels.emplace_back(label, 3);
+        graph.left.push_back(NO_NODE);
+        graph.right.push_back(NO_NODE);
+    }
+    return ids[code];
+}
 
-    std::string instructions;
-    std::getline(file_content, instructions);
-    file_content.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    auto parsed_input = parseInput(file_content);
-
-    std::unordered_map<std::string, Node> nodes;
+Graph parseInput(std::stringstream &file_content)
+{
+    Graph graph;
+    std::vector<node_id_t> ids(LABEL_CODES, NO_NODE);
 
-    for (auto &v : parsed_input)
+    std::getline(file_content, graph.instructions);
+    for (std::string line; std::getline(file_content, line);)
     {
-        std::string &key = v[0];
-        std::string &left = v[1];
-        std::string &right = v[2];
+        // "AAA = (BBB, CCC)"
+        if (line.size() < 15)
+            continue;
+        node_id_t key = internLabel(graph, ids, line.data());
+        node_id_t left = internLabel(graph, ids, line.data() + 7);
+        node_id_t right = internLabel(graph, ids, line.data() + 12);
+        graph.left[key] = left;
+        graph.right[key] = right;
+    }
 
-        Node *keyNode = nullptr;
-        Node *leftNode = nullptr;
-        Node *rightNode = nullptr;
+    for (size_t node = 0; node < graph.labels.size(); ++node)
+    {
+        if (graph.left[node] == NO_NODE)
+            graph.left[node] = graph.right[node] = node;
+    }
 
-        if (nodes.find(key) == nodes.end())
-        {
-            keyNode = &nodes[key];
-            keyNode->key = key;
-        }
+    return graph;
+}
 
-        if (nodes.find(left) == nodes.end())
-        {
-            leftNode = &nodes[left];
-            leftNode->key = left;
-        }
+PassTable buildPassTable(const Graph &graph, const std::vector<bool> &targets)
+{
+    PassTable table;
+    size_t node_count = graph.labels.size();
+    table.jump.resize(node_count);
+    table.hit_begin.resize(node_count + 1, 0);
 
-        if (nodes.find(right) == nodes.end())
+    for (size_t start = 0; start < node_count; ++start)
+    {
+        node_id_t node = start;
+        for (size_t offset = 0; offset < graph.instructions.size(); ++offset)
         {
-            rightNode = &nodes[right];
-            rightNode->key = right;
+            if (targets[node])
+                table.hit_offsets.push_back(offset);
+            node = graph.instructions[offset] == 'L' ? graph.left[node] : graph.right[node];
         }
+        table.jump[start] = node;
+        table.hit_begin[start + 1] = table.hit_offsets.size();
+    }
 
-        keyNode = &nodes[key];
-        leftNode = &nodes[left];
-        rightNode = &nodes[right];
+    return table;
+}
 
-        keyNode->left = leftNode;
-        keyNode->right = rightNode;
-    }
+GhostCycle findCycle(const PassTable &table, node_id_t start)
+{
+    GhostCycle cycle;
+    const auto &jump = table.jump;
 
-    int steps = 0;
-    Node *currentNode = &nodes["AAA"];
-    size_t instructionLength = instructions.length();
-    int instructionIndex = 0;
-    while (true)
+    size_t power = 1, lambda = 1;
+    node_id_t tortoise = start, hare = jump[start];
+    while (tortoise != hare)
     {
-        char instruction = instructions[instructionIndex++ % instructionLength];
-        if (currentNode->key == "ZZZ")
-        {
-            break;
-        }
-        if (instruction == 'R')
+        if (power == lambda)
         {
-            currentNode = currentNode->right;
+            tortoise = hare;
+            power *= 2;
+            lambda = 0;
         }
-        else if (instruction == 'L')
-        {
-            currentNode = currentNode->left;
-        }
-        steps++;
+        hare = jump[hare];
+        lambda++;
     }
 
-    return std::to_string(steps);
-}
+    size_t mu = 0;
+    tortoise = hare = start;
+    for (size_t i = 0; i < lambda; ++i)
+        hare = jump[hare];
+    while (tortoise != hare)
+    {
+        tortoise = jump[tortoise];
+        hare = jump[hare];
+        mu++;
+    }
 
-std::string part2(std::stringstream &file_content)
-{
+    cycle.mu = mu;
+    cycle.lambda = lambda;
+    cycle.path.reserve(mu + lambda);
+    for (node_id_t node = start; cycle.path.size() < mu + lambda; node = jump[node])
+        cycle.path.push_back(node);
 
-    std::string instructions;
-    std::getline(file_content, instructions);
-    file_content.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    auto parsed_input = parseInput(file_content);
+    return cycle;
+}
 
-    std::unordered_map<std::string, Node> nodes;
+bool isHitAt(const PassTable &table, const GhostCycle &cycle, size_t pass_length, step_t step)
+{
+    step_t pass = step / pass_length;
+    if (pass >= (step_t)cycle.mu)
+        pass = cycle.mu + (pass - cycle.mu) % cycle.lambda;
+
+    node_id_t node = cycle.path[(size_t)pass];
+    auto begin = table.hit_offsets.begin() + table.hit_begin[node];
+    auto end = table.hit_offsets.begin() + table.hit_begin[node + 1];
+    return std::binary_search(begin, end, (uint32_t)(step % pass_length));
+}
 
-    for (auto &v : parsed_input)
+step_t extendedGcd(step_t a, step_t b, step_t &x, step_t &y)
+{
+    if (b == 0)
     {
-        std::string &key = v[0];
-        std::string &left = v[1];
-        std::string &right = v[2];
+        x = 1;
+        y = 0;
+        return a;
+    }
+    step_t x1, y1;
+    step_t g = extendedGcd(b, a % b, x1, y1);
+    x = y1;
+    y = x1 - (a / b) * y1;
+    return g;
+}
 
-        Node *keyNode = nullptr;
-        Node *leftNode = nullptr;
-        Node *rightNode = nullptr;
+// Merges t = r1 mod m1 and t = r2 mod m2 into one congruence, moduli need not be coprime
+std::optional<std::pair<step_t, step_t>> combineCongruences(std::pair<step_t, step_t> a, std::pair<step_t, step_t> b)
+{
+    auto [r1, m1] = a;
+    auto [r2, m2] = b;
+    step_t p, q;
+    step_t g = extendedGcd(m1, m2, p, q);
+    if ((r2 - r1) % g != 0)
+        return std::nullopt;
 
-        if (nodes.find(key) == nodes.end())
-        {
-            keyNode = &nodes[key];
-            keyNode->key = key;
-        }
+    step_t m2g = m2 / g;
+    step_t k = ((r2 - r1) / g % m2g * (p % m2g)) % m2g;
+    if (k < 0)
+        k += m2g;
+    step_t lcm = m1 * m2g;
+    return std::make_pair((r1 + k * m1) % lcm, lcm);
+}
 
-        if (nodes.find(left) == nodes.end())
-        {
-            leftNode = &nodes[left];
-            leftNode->key = left;
-        }
+/*
+ * Smallest step at which every ghost stands on a target node at once, or -1.
+ * Steps before the last tail ends are checked directly; after that every
+ * ghost repeats with period lambda * pass_length and the residues are merged
+ * with the CRT.
+ */
+step_t firstCommonArrival(const Graph &graph, const std::vector<node_id_t> &starts, const std::vector<bool> &targets)
+{
+    if (starts.empty() || graph.instructions.empty())
+        return -1;
 
-        if (nodes.find(right) == nodes.end())
-        {
-            rightNode = &nodes[right];
-            rightNode->key = right;
-        }
+    size_t pass_length = graph.instructions.size();
+    PassTable table = buildPassTable(graph, targets);
 
-        keyNode = &nodes[key];
-        leftNode = &nodes[left];
-        rightNode = &nodes[right];
+    std::vector<std::future<GhostCycle>> pending;
+    for (node_id_t start : starts)
+        pending.push_back(std::async(std::launch::async, findCycle, std::cref(table), start));
+    std::vector<GhostCycle> cycles;
+    for (auto &future : pending)
+        cycles.push_back(future.get());
 
-        keyNode->left = leftNode;
-        keyNode->right = rightNode;
-    }
+    size_t longest_tail = 0;
+    for (size_t g = 1; g < cycles.size(); ++g)
+        longest_tail = cycles[g].mu > cycles[longest_tail].mu ? g : longest_tail;
+    step_t periodic_from = (step_t)cycles[longest_tail].mu * pass_length;
 
-    std::vector<Node *> current_nodes;
-    for (auto &node_pair : nodes)
+    auto allHit = [&](step_t step)
     {
-        if (node_pair.second.key.back() == 'A')
+        for (const auto &cycle : cycles)
         {
-            current_nodes.push_back(&node_pair.second);
+            if (!isHitAt(table, cycle, pass_length, step))
+                return false;
         }
-    }
-
+        return true;
+    };
 
-    int steps = 0;
-    size_t instruction_length = instructions.length();
-    int instruction_index = 0;
-
-    std::vector<std::vector<std::tuple<std::string, int, int>>> node_steps(current_nodes.size());
-    std::vector<std::vector<std::tuple<std::string, int, int>>> confirmedSteps(current_nodes.size());
-    std::vector<int> _nodes_steps_cycle_len(current_nodes.size(), 0);
-
-    while (true)
+    const GhostCycle &tail_ghost = cycles[longest_tail];
+    for (size_t pass = 0; pass < tail_ghost.mu; ++pass)
     {
-        bool will_continue = false;
-        char instruction = instructions[instruction_index];
-
-        int k = 0;
-        for (auto &node : current_nodes)
+        node_id_t node = tail_ghost.path[pass];
+        for (uint32_t h = table.hit_begin[node]; h < table.hit_begin[node + 1]; ++h)
         {
-            if (node->key.back() == 'Z')
-            {
-                auto tuple = std::make_tuple(node->key, instruction_index, _nodes_steps_cycle_len[k]);
-                _nodes_steps_cycle_len[k] = 0;
-
-                if (std::find(node_steps[k].begin(), node_steps[k].end(), tuple) == node_steps[k].end())
-                {
-                    node_steps[k].push_back(tuple);
-                }
-            }
-
-            if (node->key.back() != 'Z')
-            {
-                will_continue = true;
-            }
-
-            k++;
+            step_t step = (step_t)pass * pass_length + table.hit_offsets[h];
+            if (allHit(step))
+                return step;
         }
+    }
 
-        std::unordered_map<int, int> node_step_map;
-        for (auto node_step : node_steps)
+    std::vector<std::pair<step_t, step_t>> congruences = {{0, 1}};
+    for (const auto &cycle : cycles)
+    {
+        step_t period = (step_t)cycle.lambda * pass_length;
+        std::vector<std::pair<step_t, step_t>> merged;
+        for (size_t pass = cycle.mu; pass < cycle.mu + cycle.lambda; ++pass)
         {
-            for (auto &tuple : node_step)
+            node_id_t node = cycle.path[pass];
+            for (uint32_t h = table.hit_begin[node]; h < table.hit_begin[node + 1]; ++h)
             {
-                auto index = std::get<1>(tuple);
-                node_step_map[index]++;
-                if (node_step_map[index] == (int)current_nodes.size())
+                step_t residue = ((step_t)pass * pass_length + table.hit_offsets[h]) % period;
+                for (const auto &congruence : congruences)
                 {
-                    unsigned long long lcm = 1;
-                    for (auto &node_step : node_steps)
-                    {
-                        auto it = std::find_if(node_step.begin(), node_step.end(), [index](const std::tuple<std::string, int, int> &tuple) {
-                            return std::get<1>(tuple) == index;
-                        });
-                        auto cycleLen = std::get<2>(*it);
-                        lcm = std::lcm(lcm, cycleLen);
-                    }
-
-                    return std::to_string(lcm);
+                    auto combined = combineCongruences(congruence, {residue, period});
+                    if (combined)
+                        merged.push_back(*combined);
                 }
-                
             }
         }
+        congruences = std::move(merged);
+    }
 
-        if (!will_continue)
-        {
-            break;
-        }
+    step_t best = -1;
+    for (auto [residue, modulus] : congruences)
+    {
+        step_t step = residue;
+        if (step < periodic_from)
+            step += (periodic_from - step + modulus - 1) / modulus * modulus;
+        best = best < 0 ? step : std::min(best, step);
+    }
 
-        k = 0;
-        for (auto &node : current_nodes)
-        {
+    return best;
+}
 
-            if (instruction == 'R')
-            {
-                node = node->right;
-            }
-            else if (instruction == 'L')
-            {
-                node = node->left;
-            }
+std::string stepsToString(step_t steps)
+{
+    if (steps < 0)
+        return "-1";
+    std::string result;
+    do
+    {
+        result.insert(result.begin(), char('0' + (int)(steps % 10)));
+        steps /= 10;
+    } while (steps > 0);
+    return result;
+}
 
-            _nodes_steps_cycle_len[k]++;
-            k++;
-        }
+std::string part1(std::stringstream &file_content)
+{
+    Graph graph = parseInput(file_content);
+    std::vector<bool> targets(graph.labels.size());
+    std::vector<node_id_t> starts;
 
-        steps++;
-        instruction_index = (instruction_index + 1) % instruction_length;
+    for (size_t node = 0; node < graph.labels.size(); ++node)
+    {
+        targets[node] = graph.labels[node] == "ZZZ";
+        if (graph.labels[node] == "AAA")
+            starts.push_back(node);
     }
 
-    for (auto &node_step : node_steps)
+    return stepsToString(firstCommonArrival(graph, starts, targets));
+}
+
+std::string part2(std::stringstream &file_content)
+{
+    Graph graph = parseInput(file_content);
+    std::vector<bool> targets(graph.labels.size());
+    std::vector<node_id_t> starts;
+
+    for (size_t node = 0; node < graph.labels.size(); ++node)
     {
-        for (auto &[node, index, steps] : node_step)
-        {
-            std::cout << node << " " << index << " " << steps << "\n";
-        }
-        std::cout << "\n";
+        targets[node] = graph.labels[node].back() == 'Z';
+        if (graph.labels[node].back() == 'A')
+            starts.push_back(node);
     }
 
-    return std::to_string(steps);
+    return stepsToString(firstCommonArrival(graph, starts, targets));
 }
@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -96,110 +99,148 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-std::vector<std::vector<int>> parseInput(std::stringstream &file_content)
+/*
+ * Extrapolating a sequence of n values through its difference pyramid is
+ * the same as evaluating the degree n-1 polynomial through them:
+ *
+ *   next = sum_i (-1)^(n-1-i) C(n, i) a_i
+ *   prev = sum_i (-1)^i C(n, i+1) a_i
+ *
+ * The signed binomial weights are computed once per sequence length, and
+ * both values come from one dot product per row. Arithmetic wraps modulo
+ * 2^64, so the result is exact whenever it fits in 64 bits even if the
+ * weights themselves overflow.
+ */
+
+struct SequenceBatch
 {
-    std::vector<std::vector<int>> result;
-    std::string line;
-    while (std::getline(file_content, line))
-    {
-        std::stringstream line_stream(line);
-        std::vector<int> line_values;
-        int value;
-        while ((line_stream >> value))
-            line_values.push_back(value);
+    std::vector<int64_t> values;
+    std::vector<size_t> row_begin{0};
+};
 
-        result.push_back(line_values);
-    }
-    return result;
-}
+struct ExtrapolationWeights
+{
+    std::vector<uint64_t> next;
+    std::vector<uint64_t> prev;
+};
 
-int getNextLineValue(std::vector<int> &line)
+SequenceBatch parseInput(std::stringstream &file_content)
 {
-    bool all_zero = false;
-    std::vector<std::vector<int>> lines{line};
-    while (!all_zero)
+    SequenceBatch batch;
+
+    for (std::string line; std::getline(file_content, line);)
     {
-        all_zero = true;
-        auto &current_line = lines.back();
-        std::vector<int> next_line;
-        size_t len = current_line.size();
-        for (size_t i = 1; i < len; i++)
+        size_t row_size = batch.values.size();
+        int64_t value = 0;
+        bool negative = false, in_number = false;
+
+        for (size_t i = 0; i <= line.size(); ++i)
         {
-            int val = current_line[i] - current_line[i - 1];
-            if (val != 0)            
-                all_zero = false;
-            
-            next_line.push_back(val);
+            char c = i < line.size() ? line[i] : ' ';
+            if (c >= '0' && c <= '9')
+            {
+                value = value * 10 + (c - '0');
+                in_number = true;
+            }
+            else if (c == '-')
+                negative = true;
+            else
+            {
+                if (in_number)
+                    batch.values.push_back(negative ? -value : value);
+                value = 0;
+                negative = in_number = false;
+            }
         }
 
-        lines.push_back(next_line);
-    }
-
-    size_t len = lines.size();
-    for (size_t i = len - 1; i > 0; i--)
-    {
-        auto &current_line = lines[i];
-        auto &prev_line = lines[i - 1];
-        prev_line.push_back(current_line.back() + prev_line.back());
+        if (batch.values.size() != row_size)
+            batch.row_begin.push_back(batch.values.size());
     }
 
-    return lines.front().back();
+    return batch;
 }
 
-int getPrevLineValue(std::vector<int> &line)
+std::vector<ExtrapolationWeights> computeWeights(size_t max_length)
 {
-    bool all_zero = false;
-    std::reverse(line.begin(), line.end());
-    std::vector<std::vector<int>> lines{line};
-    while (!all_zero)
+    std::vector<ExtrapolationWeights> weights(max_length + 1);
+    std::vector<uint64_t> binomials{1};
+
+    for (size_t n = 1; n <= max_length; ++n)
     {
-        all_zero = true;
-        auto &current_line = lines.back();
-        std::vector<int> next_line;
-        size_t len = current_line.size();
-        for (size_t i = 1; i < len; i++)
+        std::vector<uint64_t> row(n + 1, 1);
+        for (size_t k = 1; k < n; ++k)
+            row[k] = binomials[k - 1] + binomials[k];
+        binomials = std::move(row);
+
+        auto &current = weights[n];
+        current.next.resize(n);
+        current.prev.resize(n);
+        for (size_t i = 0; i < n; ++i)
         {
-            int val = current_line[i - 1] - current_line[i];
-            if (val != 0)
-                all_zero = false;
-
-            next_line.push_back(val);
+            current.next[i] = (n - 1 - i) % 2 ? -binomials[i] : binomials[i];
+            current.prev[i] = i % 2 ? -binomials[i + 1] : binomials[i + 1];
         }
-
-        lines.push_back(next_line);
     }
 
+    return weights;
+}
 
-    size_t len = lines.size();
+/*
+ * Returns the sums of the next and previous values of every row. Rows are
+ * split in contiguous chunks, one per thread.
+ */
+std::pair<int64_t, int64_t> extrapolateAll(const SequenceBatch &batch)
+{
+    size_t rows = batch.row_begin.size() - 1;
+    size_t max_length = 0;
+    for (size_t r = 0; r < rows; ++r)
+        max_length = std::max(max_length, batch.row_begin[r + 1] - batch.row_begin[r]);
+    std::vector<ExtrapolationWeights> weights = computeWeights(max_length);
 
-    for (size_t i = len - 1; i > 0; i--)
-    {
-        auto &current_line = lines[i];
-        auto &prev_line = lines[i - 1];
-        prev_line.push_back(prev_line.back() - current_line.back());
-    }
+    constexpr size_t ROWS_PER_THREAD = 4096;
+    size_t thread_count = std::clamp<size_t>(rows / ROWS_PER_THREAD, 1, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<uint64_t> next_sums(thread_count, 0), prev_sums(thread_count, 0);
 
-    return lines.front().back();
+    auto worker = [&](size_t t)
+    {
+        uint64_t next_sum = 0, prev_sum = 0;
+        for (size_t r = rows * t / thread_count; r < rows * (t + 1) / thread_count; ++r)
+        {
+            const int64_t *values = batch.values.data() + batch.row_begin[r];
+            const auto &row_weights = weights[batch.row_begin[r + 1] - batch.row_begin[r]];
+            size_t length = row_weights.next.size();
+
+            uint64_t next = 0, prev = 0;
+            for (size_t i = 0; i < length; ++i)
+            {
+                next += row_weights.next[i] * (uint64_t)values[i];
+                prev += row_weights.prev[i] * (uint64_t)values[i];
+            }
+            next_sum += next;
+            prev_sum += prev;
+        }
+        next_sums[t] = next_sum;
+        prev_sums[t] = prev_sum;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    uint64_t next_total = std::accumulate(next_sums.begin(), next_sums.end(), uint64_t(0));
+    uint64_t prev_total = std::accumulate(prev_sums.begin(), prev_sums.end(), uint64_t(0));
+    return {(int64_t)next_total, (int64_t)prev_total};
 }
 
 std::string part1(std::stringstream &file_content)
 {
-
-    auto input = parseInput(file_content);
-    int sum = 0;
-    for (auto &line : input)
-        sum += getNextLineValue(line);
-
-    return std::to_string(sum);
+    return std::to_string(extrapolateAll(parseInput(file_content)).first);
 }
 
 std::string part2(std::stringstream &file_content)
 {
-
-    auto input = parseInput(file_content);
-    int sum = 0;
-    for (auto &line : input)
-        sum += getPrevLineValue(line);
-
-    return std::to_string(sum);
-}
\ No newline at end of file
+    return std::to_string(extrapolateAll(parseInput(file_content)).second);
+}
@@ -9,8 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <unordered_map>
-#include <queue>
-#include <unordered_set>
+#include <array>
+#include <cstdint>
 
 /*************
  * Setup code
@@ -105,256 +105,182 @@ namespace Direction
     constexpr int None = 4;
 }
 
-namespace Turn
-{
-    constexpr int Left = 0;
-    constexpr int Righ = 1;
-    constexpr int None = 2;
-}
-
 const std::array<std::array<int, 2>, 5> dirs = {{{-1, 0},
                                                  {0, 1},
                                                  {1, 0},
                                                  {0, -1},
                                                  {0, 0}}};
 
-const std::array<std::array<int, 2>, 2> turns = {{{-1, 1},
-                                                  {1, -1}}};
-
-using next_direction_t = std::array<int, 4>;
-using next_rotation_t = std::array<int, 4>;
 using direction_t = int;
 using position_t = std::array<int, 2>;
-using steps_t = int;
-
-std::unordered_map<char, next_direction_t> next_directions_map = {
-    //      NORTH,              EAST,             SOUTH,            WEST
-    {'|', {Direction::Nort, Direction::None, Direction::Sout, Direction::None}},
-    {'-', {Direction::None, Direction::East, Direction::None, Direction::West}},
-    {'L', {Direction::None, Direction::None, Direction::East, Direction::Nort}},
-    {'J', {Direction::None, Direction::Nort, Direction::West, Direction::None}},
-    {'7', {Direction::West, Direction::Sout, Direction::None, Direction::None}},
-    {'F', {Direction::East, Direction::None, Direction::None, Direction::Sout}},
-    {'.', {Direction::None, Direction::None, Direction::None, Direction::None}},
-    {'S', {Direction::None, Direction::None, Direction::None, Direction::None}},
+using transition_table_t = std::array<std::array<uint8_t, 4>, 256>;
 
-};
+// Build with -DRENDER_LOOP=1 to print the loop and its inside to stdout
+#ifndef RENDER_LOOP
+#define RENDER_LOOP 0
+#endif
 
-std::unordered_map<char, next_rotation_t> next_rotations_map = {
-    //      NORTH,              EAST,             SOUTH,            WEST
-    {'|', {Turn::None, Turn::None, Turn::None, Turn::None}},
-    {'-', {Turn::None, Turn::None, Turn::None, Turn::None}},
-    {'L', {Turn::None, Turn::None, Turn::Left, Turn::Righ}},
-    {'J', {Turn::None, Turn::Left, Turn::Righ, Turn::None}},
-    {'7', {Turn::Left, Turn::Righ, Turn::None, Turn::None}},
-    {'F', {Turn::Righ, Turn::None, Turn::None, Turn::Left}},
-    {'.', {Turn::None, Turn::None, Turn::None, Turn::None}},
-    {'S', {Turn::None, Turn::None, Turn::None, Turn::None}},
+constexpr transition_table_t makeTransitions()
+{
+    transition_table_t table{};
+    for (auto &entry : table)
+        entry = {Direction::None, Direction::None, Direction::None, Direction::None};
+
+    //                 NORTH,           EAST,            SOUTH,           WEST
+    table['|'] = {Direction::Nort, Direction::None, Direction::Sout, Direction::None};
+    table['-'] = {Direction::None, Direction::East, Direction::None, Direction::West};
+    table['L'] = {Direction::None, Direction::None, Direction::East, Direction::Nort};
+    table['J'] = {Direction::None, Direction::Nort, Direction::West, Direction::None};
+    table['7'] = {Direction::West, Direction::Sout, Direction::None, Direction::None};
+    table['F'] = {Direction::East, Direction::None, Direction::None, Direction::Sout};
+    return table;
+}
 
-};
+// Outgoing direction for a pipe character entered while heading in a direction
+constexpr transition_table_t next_direction = makeTransitions();
 
-std::unordered_map<char, std::string> direction_to_unicode = {
-    {'|', "│"},
-    {'-', "─"},
-    {'L', "└"},
-    {'J', "┘"},
-    {'7', "┐"},
-    {'F', "┌"},
-    {'.', "·"},
-    {'S', "S"},
+struct LoopSummary
+{
+    long long length = 0;
+    long long twice_area = 0;
+    position_t start = {0, 0};
+    direction_t first_direction = Direction::None;
+    direction_t last_direction = Direction::None;
 };
 
 std::vector<std::string> parseInput(std::stringstream &file_content)
 {
     std::vector<std::string> lines;
-    std::string line;
-    while (std::getline(file_content, line))
+    for (std::string line; std::getline(file_content, line);)
     {
-        lines.push_back("." + line + ".");
+        if (!line.empty())
+            lines.push_back(line);
     }
-    std::string top_bottom = std::string(lines[0].size(), '.');
-    lines.insert(lines.begin(), top_bottom);
-    lines.push_back(top_bottom);
     return lines;
 }
 
-std::string part1(std::stringstream &file_content)
+inline char tileAt(const std::vector<std::string> &map, int row, int col)
 {
-    auto input_map = parseInput(file_content);
-
-    int width = input_map[0].size();
-    int height = input_map.size();
-
-    std::vector<std::vector<bool>> visited_map(height, std::vector<bool>(width, false));
+    if (row < 0 || row >= (int)map.size() || col < 0 || col >= (int)map[row].size())
+        return '.';
+    return map[row][col];
+}
 
-    std::array<int, 2> pos = {0, 0};
-    bool start_found = false;
+/*
+ * Walks the loop once from S, accumulating the shoelace sum over the visited
+ * cells. When loop_cells is given, the cells of the loop are flagged in it.
+ */
+LoopSummary walkLoop(const std::vector<std::string> &map, std::vector<std::vector<bool>> *loop_cells = nullptr)
+{
+    LoopSummary summary;
 
-    //get the starting position
-    for (size_t row = 0; row < input_map.size(); row++)
+    for (size_t row = 0; row < map.size(); row++)
     {
-        for (size_t col = 0; col < input_map[row].size(); col++)
-        {
-            if (input_map[row][col] == 'S')
-            {
-                pos = {static_cast<int>(row), static_cast<int>(col)};
-                start_found = true;
-                break;
-            }
-        }
-        if (start_found)
+        size_t col = map[row].find('S');
+        if (col != std::string::npos)
         {
+            summary.start = {(int)row, (int)col};
             break;
         }
     }
 
-    std::queue<std::tuple<position_t, direction_t, steps_t>> queue;
-    visited_map[pos[0]][pos[1]] = true;
-
-    //get the starting directions
-    for (size_t i = 0; i < 4; i++)
+    for (direction_t dir = 0; dir < 4 && summary.first_direction == Direction::None; dir++)
     {
-        position_t next_pos = {pos[0] + dirs[i][0], pos[1] + dirs[i][1]};
-        if (next_directions_map[input_map[next_pos[0]][next_pos[1]]][i] != Direction::None)
-            queue.push({pos, i, 0});
+        char neighbour = tileAt(map, summary.start[0] + dirs[dir][0], summary.start[1] + dirs[dir][1]);
+        if (next_direction[(unsigned char)neighbour][dir] != Direction::None)
+            summary.first_direction = dir;
     }
 
-    //walk around the pipe until we reach the farthest point
-    int max_steps = 0;
-    while (!queue.empty())
+    position_t pos = summary.start;
+    direction_t dir = summary.first_direction;
+    while (dir != Direction::None)
     {
-        auto [pos, dir, steps] = queue.front();
-        queue.pop();
-        max_steps = std::max(max_steps, steps);
         position_t next_pos = {pos[0] + dirs[dir][0], pos[1] + dirs[dir][1]};
-
-        if (visited_map[next_pos[0]][next_pos[1]])
-            continue;
-
-        if (next_directions_map[input_map[next_pos[0]][next_pos[1]]][dir] == Direction::None)
-            continue;
-
-        queue.push({next_pos, next_directions_map[input_map[next_pos[0]][next_pos[1]]][dir], steps + 1});
-        visited_map[next_pos[0]][next_pos[1]] = true;
+        summary.twice_area += (long long)pos[0] * next_pos[1] - (long long)next_pos[0] * pos[1];
+        summary.length++;
+        summary.last_direction = dir;
+        if (loop_cells)
+            (*loop_cells)[pos[0]][pos[1]] = true;
+
+        pos = next_pos;
+        if (pos == summary.start)
+            break;
+        dir = next_direction[(unsigned char)tileAt(map, pos[0], pos[1])][dir];
     }
 
-    return std::to_string(max_steps);
+    return summary;
 }
 
-std::string part2(std::stringstream &file_content)
+// Pick's theorem: area = inside + boundary / 2 - 1
+long long countEnclosedTiles(const LoopSummary &summary)
 {
+    return std::abs(summary.twice_area) / 2 - summary.length / 2 + 1;
+}
 
-    auto input_map = parseInput(file_content);
-
-    int width = input_map[0].size();
-    int height = input_map.size();
-
-    std::vector<std::vector<bool>> visited_map(height, std::vector<bool>(width, false));
-    std::vector<std::vector<int>> inout_map(height, std::vector<int>(width, 0));
-
-    std::array<int, 2> starting_pos = {0, 0};
-    bool start_found = false;
-
-    //get the starting position
-    for (size_t row = 0; row < input_map.size() && !start_found; row++)
-        for (size_t col = 0; col < input_map[row].size() && !start_found; col++)
-        {
-            if (input_map[row][col] == 'S')
-            {
-                starting_pos = {static_cast<int>(row), static_cast<int>(col)};
-                start_found = true;
-                break;
-            }
-        }
-
-    //get the starting direction
-    std::queue<std::tuple<position_t, direction_t, steps_t, position_t, position_t>> queue;
-    visited_map[starting_pos[0]][starting_pos[1]] = true;
-
-    for (size_t i = 0; i < 4; i++)
+char startShape(const LoopSummary &summary)
+{
+    int connections = (1 << summary.first_direction) | (1 << ((summary.last_direction + 2) % 4));
+    switch (connections)
     {
-        position_t next_pos = {starting_pos[0] + dirs[i][0], starting_pos[1] + dirs[i][1]};
-        if (next_directions_map[input_map[next_pos[0]][next_pos[1]]][i] != Direction::None)
-        {
-            position_t vector_left = {dirs[i][1] * turns[Turn::Left][0], dirs[i][0] * turns[Turn::Left][1]};
-            position_t vector_right = {dirs[i][1] * turns[Turn::Righ][0], dirs[i][0] * turns[Turn::Righ][1]};
-            queue.push({starting_pos, i, 0, vector_left, vector_right});
-            break;
-        }
+    case (1 << Direction::Nort) | (1 << Direction::Sout):
+        return '|';
+    case (1 << Direction::East) | (1 << Direction::West):
+        return '-';
+    case (1 << Direction::Nort) | (1 << Direction::East):
+        return 'L';
+    case (1 << Direction::Nort) | (1 << Direction::West):
+        return 'J';
+    case (1 << Direction::Sout) | (1 << Direction::West):
+        return '7';
+    default:
+        return 'F';
     }
+}
 
-    //walk around the pipe and flag the inside
-    while (!queue.empty())
-    {
-        auto [pos, dir, steps, vector_left, vector_right] = queue.front();
-        queue.pop();
-
-        inout_map[pos[0] + vector_left[0]][pos[1] + vector_left[1]]++;
-        inout_map[pos[0] + vector_right[0]][pos[1] + vector_right[1]]--;
-
-        position_t next_pos = {pos[0] + dirs[dir][0], pos[1] + dirs[dir][1]};
-
-        if (next_directions_map[input_map[next_pos[0]][next_pos[1]]][dir] == Direction::None)
-            break;
-
-        inout_map[next_pos[0] + vector_left[0]][pos[1] + vector_left[1]]++;
-        inout_map[next_pos[0] + vector_right[0]][pos[1] + vector_right[1]]--;
-
-        int next_rotation = next_rotations_map[input_map[next_pos[0]][next_pos[1]]][dir];
-        position_t next_vector_left = vector_left;
-        position_t next_vector_right = vector_right;
-
-        if (next_rotation != Turn::None)
-        {
-            next_vector_left = {vector_left[1] * turns[next_rotation][0], vector_left[0] * turns[next_rotation][1]};
-            next_vector_right = {vector_right[1] * turns[next_rotation][0], vector_right[0] * turns[next_rotation][1]};
-        }
-
-        queue.push({next_pos, next_directions_map[input_map[next_pos[0]][next_pos[1]]][dir], steps + 1, next_vector_left, next_vector_right});
-        visited_map[next_pos[0]][next_pos[1]] = true;
-    }
+void renderLoop(const std::vector<std::string> &map)
+{
+    const std::unordered_map<char, std::string> direction_to_unicode = {
+        {'|', "│"}, {'-', "─"}, {'L', "└"}, {'J', "┘"}, {'7', "┐"}, {'F', "┌"}};
 
+    std::vector<std::vector<bool>> loop_cells(map.size());
+    for (size_t row = 0; row < map.size(); row++)
+        loop_cells[row].assign(map[row].size(), false);
+    LoopSummary summary = walkLoop(map, &loop_cells);
 
-    //fill the gaps and count the total in
-    int totalin = 0;
-    for (size_t row = 1; row < input_map.size() - 1; row++)
+    // A cell is inside when a ray to its left crosses the loop an odd number of times
+    for (size_t row = 0; row < map.size(); row++)
     {
         bool is_in = false;
-        for (size_t col = 1; col < input_map[row].size() - 1; col++)
-        {
-            if (visited_map[row][col])
-            {
-                is_in = false;
-                continue;
-            }
-            if (inout_map[row][col] < 0)
-                is_in = true;
-            if (is_in)
-                totalin++, inout_map[row][col] = -1;
-        }
-    }
-
-    //print the map
-    for (size_t row = 0; row < input_map.size(); row++)
-    {
-        for (size_t col = 0; col < input_map[row].size(); col++)
+        for (size_t col = 0; col < map[row].size(); col++)
         {
-            if (visited_map[row][col])
+            char tile = map[row][col] == 'S' ? startShape(summary) : map[row][col];
+            if (loop_cells[row][col])
             {
-                std::cout << direction_to_unicode[input_map[row][col]];
+                is_in ^= tile == '|' || tile == 'L' || tile == 'J';
+                std::cout << direction_to_unicode.at(tile);
             }
             else
-            {
-                if (inout_map[row][col] < 0)
-                {
-                    std::cout << 'X';
-                }
-                else
-                    std::cout << " ";
-            }
+                std::cout << (is_in ? 'X' : ' ');
         }
         std::cout << std::endl;
     }
+}
+
+std::string part1(std::stringstream &file_content)
+{
+    auto input_map = parseInput(file_content);
+    LoopSummary summary = walkLoop(input_map);
+
+    return std::to_string(summary.length / 2);
+}
+
+std::string part2(std::stringstream &file_content)
+{
+    auto input_map = parseInput(file_content);
+    LoopSummary summary = walkLoop(input_map);
+
+    if (RENDER_LOOP)
+        renderLoop(input_map);
 
-    return std::to_string(totalin);
+    return std::to_string(countEnclosedTiles(summary));
 }
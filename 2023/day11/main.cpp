@@ -106,150 +106,80 @@ std::vector<std::string> parseInput(std::stringstream &file_content)
     return input;
 }
 
-std::string part1(std::stringstream &file_content)
+/*
+ * The sum of distances splits per axis. Between two consecutive lines, every
+ * pair with one galaxy on each side crosses the gap, so an axis contributes
+ * sum(before_i * after_i * width_i), where an empty line is `expansion` wide.
+ * This is base + (expansion - 1) * empty, so one scan of the per-line galaxy
+ * counts answers any expansion factor.
+ */
+struct AxisDistances
 {
+    unsigned long long base = 0;
+    unsigned long long empty = 0;
+};
 
-    auto input_map = parseInput(file_content);
-
-    int width = input_map[0].size();
-    int height = input_map.size();
-    std::vector<bool> empty_rows(height, true);
-    std::vector<bool> empty_cols(width, true);
-
-    for (int i = 0; i < height; i++)
-    {
-        bool empty = true;
-        for (int j = 0; j < width; j++)
-        {
-            if (input_map[i][j] == '#')
-            {
-                empty = false;
-                break;
-            }
-        }
-        empty_rows[i] = empty;
-    }
+struct GalaxyDistances
+{
+    AxisDistances rows;
+    AxisDistances cols;
 
-    for (int i = 0; i < width; i++)
+    unsigned long long sumForExpansion(unsigned long long expansion) const
     {
-        bool empty = true;
-        for (int j = 0; j < height; j++)
-        {
-            if (input_map[j][i] == '#')
-            {
-                empty = false;
-                break;
-            }
-        }
-        empty_cols[i] = empty;
+        return rows.base + cols.base + (expansion - 1) * (rows.empty + cols.empty);
     }
+};
 
-    std::vector<std::pair<int, int>> galaxies;
-
-    int offset_x = 0;
-    int offset_y = 0;
-    for (int i = 0; i < height; ++i)
-    {
-        if (empty_rows[i])
-        {
-            offset_y++;
-            continue;
-        }
-        offset_x = 0;
-        for (int j = 0; j < width; ++j)
-        {
-            if (empty_cols[j])
-            {
-                offset_x++;
-                continue;
-            }
-            if (input_map[i][j] == '#')
-            {
-                galaxies.push_back({i + offset_y, j + offset_x});
-            }
-        }
-    }
+AxisDistances sumAxisDistances(const std::vector<unsigned long long> &galaxies_per_line)
+{
+    AxisDistances distances;
+    unsigned long long total = std::accumulate(galaxies_per_line.begin(), galaxies_per_line.end(), 0ULL);
+    unsigned long long before = 0;
 
-    int sum_distances = 0;
-    for (size_t i = 0; i < galaxies.size(); ++i)
+    for (unsigned long long count : galaxies_per_line)
     {
-        for (size_t j = i + 1; j < galaxies.size(); ++j)
-            sum_distances += std::abs(galaxies[i].first - galaxies[j].first) + std::abs(galaxies[i].second - galaxies[j].second);
+        before += count;
+        unsigned long long crossing = before * (total - before);
+        distances.base += crossing;
+        if (count == 0)
+            distances.empty += crossing;
     }
 
-    return std::to_string(sum_distances);
+    return distances;
 }
 
-std::string part2(std::stringstream &file_content)
+GalaxyDistances scanGalaxies(std::stringstream &file_content)
 {
-
     auto input_map = parseInput(file_content);
+    std::vector<unsigned long long> galaxies_per_row;
+    std::vector<unsigned long long> galaxies_per_col;
 
-    int width = input_map[0].size();
-    int height = input_map.size();
-    std::vector<bool> empty_rows(height, true);
-    std::vector<bool> empty_cols(width, true);
-
-    for (int i = 0; i < height; i++)
+    for (const auto &line : input_map)
     {
-        bool empty = true;
-        for (int j = 0; j < width; j++)
-        {
-            if (input_map[i][j] == '#')
-            {
-                empty = false;
-                break;
-            }
-        }
-        empty_rows[i] = empty;
-    }
+        if (line.empty())
+            continue;
+        if (galaxies_per_col.size() < line.size())
+            galaxies_per_col.resize(line.size(), 0);
 
-    for (int i = 0; i < width; i++)
-    {
-        bool empty = true;
-        for (int j = 0; j < height; j++)
+        unsigned long long row_count = 0;
+        for (size_t col = 0; col < line.size(); ++col)
         {
-            if (input_map[j][i] == '#')
-            {
-                empty = false;
-                break;
-            }
+            bool is_galaxy = line[col] == '#';
+            row_count += is_galaxy;
+            galaxies_per_col[col] += is_galaxy;
         }
-        empty_cols[i] = empty;
+        galaxies_per_row.push_back(row_count);
     }
 
-    std::vector<std::pair<long long, long long>> galaxies;
-
-    long long offset_x = 0;
-    long long offset_y = 0;
-    for (int i = 0; i < height; ++i)
-    {
-        if (empty_rows[i])
-        {
-            offset_y += 999999;
-            continue;
-        }
-        offset_x = 0;
-        for (int j = 0; j < width; ++j)
-        {
-            if (empty_cols[j])
-            {
-                offset_x += 999999;
-                continue;
-            }
-            if (input_map[i][j] == '#')
-            {
-                galaxies.push_back({(long long)i + offset_y, (long long)j + offset_x});
-            }
-        }
-    }
+    return {sumAxisDistances(galaxies_per_row), sumAxisDistances(galaxies_per_col)};
+}
 
-    unsigned long long sum_distances = 0;
-    for (size_t i = 0; i < galaxies.size(); ++i)
-    {
-        for (size_t j = i + 1; j < galaxies.size(); ++j)
-            sum_distances += std::abs(galaxies[i].first - galaxies[j].first) + std::abs(galaxies[i].second - galaxies[j].second);
-    }
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(scanGalaxies(file_content).sumForExpansion(2));
+}
 
-    return std::to_string(sum_distances);
+std::string part2(std::stringstream &file_content)
+{
+    return std::to_string(scanGalaxies(file_content).sumForExpansion(1000000));
 }
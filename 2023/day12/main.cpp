@@ -9,6 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <queue>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -94,111 +96,144 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-unsigned long long getArrangements(std::string &line, std::vector<int> &container, int lineidx, int containerIdx, int currentCount, std::unordered_map<int, unsigned long long> &cache)
+/*
+ * Arrangements are counted with a rolling DP over (position, group). Rows are
+ * unfolded virtually: position i of a row unfolded k times reads
+ * pattern[i % (n + 1)], with '?' at the joints, and group g is groups[g % m].
+ *
+ * run_length[i] holds how many cells starting at i could be '#', so a group
+ * fits at i in O(1). hash_count[i] counts the '#' in [0, i), to check that a
+ * stretch between two groups holds no '#'.
+ */
+
+struct ArrangementBuffers
 {
-    int cache_key = lineidx * 10000 + containerIdx * 100 + currentCount;
-    if (cache.find(cache_key) != cache.end())
-        return cache[cache_key];
-
-    if (lineidx == (int)line.size())
-    {
-        if (containerIdx == (int)container.size() - 1 && currentCount == container[containerIdx])
-            return 1;
-        else if (containerIdx == (int)container.size() && currentCount == 0)
-            return 1;
-
-        return 0;
-    }
+    std::vector<unsigned int> run_length;
+    std::vector<unsigned int> hash_count;
+    std::vector<unsigned long long> ways;
+    std::vector<unsigned long long> next_ways;
+};
 
-    if (currentCount && containerIdx == (int)container.size())
-        return 0;
+using record_t = std::pair<std::string, std::vector<int>>;
 
-    if (currentCount && currentCount > container[containerIdx])
-        return 0;
+unsigned long long countArrangements(const record_t &record, int unfold, ArrangementBuffers &buffers)
+{
+    const std::string &pattern = record.first;
+    size_t pattern_size = pattern.size();
+    size_t size = unfold * (pattern_size + 1) - 1;
+    size_t group_count = unfold * record.second.size();
 
-    unsigned long long res = 0;
-    if (line[lineidx] == '.')
+    auto cell = [&](size_t i)
     {
-        if (currentCount && currentCount < container[containerIdx])
-            return 0;
-        res = getArrangements(line, container, lineidx + 1, currentCount ? containerIdx + 1 : containerIdx, 0, cache);
-    }
-
-    if (line[lineidx] == '#')
+        size_t offset = i % (pattern_size + 1);
+        return offset == pattern_size ? '?' : pattern[offset];
+    };
+
+    auto &run_length = buffers.run_length;
+    auto &hash_count = buffers.hash_count;
+    run_length.assign(size + 1, 0);
+    hash_count.assign(size + 1, 0);
+    for (size_t i = size; i-- > 0;)
+        run_length[i] = cell(i) == '.' ? 0 : run_length[i + 1] + 1;
+    for (size_t i = 0; i < size; ++i)
+        hash_count[i + 1] = hash_count[i] + (cell(i) == '#');
+
+    // ways[i]: arrangements of the groups placed so far, the last one (and
+    // its separator) ending right before i
+    auto &ways = buffers.ways;
+    auto &next_ways = buffers.next_ways;
+    ways.assign(size + 1, 0);
+    ways[0] = 1;
+
+    for (size_t g = 0; g < group_count; ++g)
     {
-        res = getArrangements(line, container, lineidx + 1, containerIdx, currentCount + 1, cache);
-    }
+        size_t length = record.second[g % record.second.size()];
+        next_ways.assign(size + 1, 0);
 
-    if (line[lineidx] == '?')
-    {
-        unsigned long long sum = 0;
-        if (currentCount && currentCount < container[containerIdx])
-            sum = 0;
-        else
-            sum = getArrangements(line, container, lineidx + 1, currentCount ? containerIdx + 1 : containerIdx, 0, cache);
-        sum += getArrangements(line, container, lineidx + 1, containerIdx, currentCount + 1, cache);
-        res = sum;
+        // reachable sums ways[i] for every i <= start with no '#' in [i, start)
+        unsigned long long reachable = 0;
+        for (size_t start = 0; start + length <= size; ++start)
+        {
+            reachable = ways[start] + (start > 0 && cell(start - 1) != '#' ? reachable : 0);
+            if (!reachable || run_length[start] < length)
+                continue;
+            size_t end = start + length;
+            if (end < size && cell(end) == '#')
+                continue;
+            next_ways[std::min(end + 1, size)] += reachable;
+        }
+
+        ways.swap(next_ways);
     }
 
-    return cache[cache_key] = res;
+    unsigned long long total = 0;
+    for (size_t i = 0; i <= size; ++i)
+        total += hash_count[size] == hash_count[i] ? ways[i] : 0;
+
+    return total;
 }
 
-std::vector<std::pair<std::string, std::vector<int>>> parseInput(std::stringstream &file_content)
+std::vector<record_t> parseInput(std::stringstream &file_content)
 {
-    std::vector<std::pair<std::string, std::vector<int>>> lines;
+    std::vector<record_t> lines;
 
-    std::string line;
-    while (std::getline(file_content, line))
+    for (std::string line; std::getline(file_content, line);)
     {
-        std::stringstream line_stream(line);
-        std::string line_str;
-        std::vector<int> container;
-        line_stream >> line_str;
+        size_t space = line.find(' ');
+        if (space == std::string::npos)
+            continue;
 
-        for (std::string container_str; std::getline(line_stream, container_str, ',');)
+        std::vector<int> container;
+        int value = 0;
+        for (size_t i = space + 1; i <= line.size(); ++i)
         {
-            container.push_back(std::stoi(container_str));
+            if (i < line.size() && std::isdigit(line[i]))
+                value = value * 10 + (line[i] - '0');
+            else
+            {
+                container.push_back(value);
+                value = 0;
+            }
         }
 
-        lines.push_back(std::make_pair(line_str, container));
+        lines.push_back(std::make_pair(line.substr(0, space), container));
     }
 
     return lines;
 }
 
-std::string part1(std::stringstream &file_content)
+/*
+ * Sums the arrangements of every row, rows being split in contiguous chunks
+ * across threads, each with its own DP buffers.
+ */
+unsigned long long sumArrangements(const std::vector<record_t> &lines, int unfold)
 {
+    size_t thread_count = std::clamp<size_t>(lines.size() / 64, 1, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<unsigned long long> sums(thread_count, 0);
 
-    auto lines = parseInput(file_content);
-    unsigned long long sum = 0;
-    for (auto &line : lines)
+    auto worker = [&](size_t t)
     {
-        std::unordered_map<int, unsigned long long> cache;
-        int res = getArrangements(line.first, line.second, 0, 0, 0, cache);
-        sum += res;
-    }
+        ArrangementBuffers buffers;
+        for (size_t i = lines.size() * t / thread_count; i < lines.size() * (t + 1) / thread_count; ++i)
+            sums[t] += countArrangements(lines[i], unfold, buffers);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    return std::accumulate(sums.begin(), sums.end(), 0ULL);
+}
 
-    return std::to_string(sum);
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(sumArrangements(parseInput(file_content), 1));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-
-    auto lines = parseInput(file_content);
-
-    unsigned long long sum = 0;
-    for (auto &line : lines)
-    {
-
-        std::unordered_map<int, unsigned long long> cache;
-
-        line.first = line.first + "?" + line.first + "?" + line.first + "?" + line.first + "?" + line.first;
-        auto initial_container = line.second;
-        for (int i = 0; i < 4; i++)
-            line.second.insert(line.second.end(), initial_container.begin(), initial_container.end());
-
-        sum += getArrangements(line.first, line.second, 0, 0, 0, cache);
-    }
-
-    return std::to_string(sum);
+    return std::to_string(sumArrangements(parseInput(file_content), 5));
 }
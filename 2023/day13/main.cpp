@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -96,34 +99,67 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-std::vector<std::pair<std::vector<int>, std::vector<int>>> parseInput(std::stringstream &file_content)
+/*
+ * Each pattern keeps its rows and its columns as bit masks of 64-bit words,
+ * so patterns of any width work. A mirror axis is accepted when the summed
+ * Hamming distance of its mirrored pairs equals the smudge budget; the scan
+ * stops as soon as the budget is exceeded.
+ */
+
+struct LineMasks
 {
-    std::string line;
-    std::vector<std::string> lines;
+    int count = 0;
+    int words = 0;
+    std::vector<uint64_t> bits;
+
+    const uint64_t *line(int i) const { return bits.data() + (size_t)i * words; }
+};
 
-    std::vector<std::pair<std::vector<int>, std::vector<int>>> tile_values;
+struct Pattern
+{
+    LineMasks rows;
+    LineMasks cols;
+};
 
-    while (std::getline(file_content, line))
+LineMasks makeLineMasks(int count, int length)
+{
+    LineMasks masks;
+    masks.count = count;
+    masks.words = (length + 63) / 64;
+    masks.bits.assign((size_t)count * masks.words, 0);
+    return masks;
+}
+
+Pattern makePattern(const std::vector<std::string> &lines)
+{
+    int height = lines.size();
+    int width = lines[0].size();
+    Pattern pattern{makeLineMasks(height, width), makeLineMasks(width, height)};
+
+    for (int i = 0; i < height; i++)
     {
-        if (line.empty())
+        for (int j = 0; j < width && j < (int)lines[i].size(); j++)
         {
-            int width = lines[0].size();
-            int height = lines.size();
-
-            std::vector<int> row_values(height, 0);
-            std::vector<int> col_values(width, 0);
+            uint64_t rock = lines[i][j] == '#';
+            pattern.rows.bits[(size_t)i * pattern.rows.words + j / 64] |= rock << (j % 64);
+            pattern.cols.bits[(size_t)j * pattern.cols.words + i / 64] |= rock << (i % 64);
+        }
+    }
 
-            for (int i = 0; i < height; i++)
-            {
-                for (int j = 0; j < width; j++)
-                {
-                    row_values[i] |= (lines[i][j] == '#' ? 1 : 0) << j;
-                    col_values[j] |= (lines[i][j] == '#' ? 1 : 0) << i;
-                }
-            }
+    return pattern;
+}
 
-            tile_values.push_back(std::make_pair(row_values, col_values));
+std::vector<Pattern> parseInput(std::stringstream &file_content)
+{
+    std::vector<std::string> lines;
+    std::vector<Pattern> patterns;
 
+    for (std::string line; std::getline(file_content, line);)
+    {
+        if (line.empty())
+        {
+            if (!lines.empty())
+                patterns.push_back(makePattern(lines));
             lines.clear();
             continue;
         }
@@ -131,47 +167,63 @@ std::vector<std::pair<std::vector<int>, std::vector<int>>> parseInput(std::strin
         lines.push_back(line);
     }
 
-    return tile_values;
+    if (!lines.empty())
+        patterns.push_back(makePattern(lines));
+
+    return patterns;
 }
 
-int evalSymmetryIndex(std::vector<int> &values, int max_fixes)
+int evalSymmetryIndex(const LineMasks &masks, int smudges)
 {
-    for (int i = 0, arr_size = values.size(); i < arr_size - 1; i++)
+    for (int axis = 1; axis < masks.count; axis++)
     {
-        int match = false;
-        int xored_fix = values[i] ^ values[i + 1];
-        int smudge_fixed = xored_fix && (xored_fix & (xored_fix - 1)) == 0;
-        if (values[i] == values[i + 1] || smudge_fixed)
+        int distance = 0;
+        for (int h = axis - 1, k = axis; h >= 0 && k < masks.count && distance <= smudges; h--, k++)
         {
-            match = true;
-            for (int h = i - 1, k = i + 2; h >= 0 && k < arr_size && match; h--, k++)
-            {
-                int xored_fix = values[h] ^ values[k];
-                int can_fix = xored_fix && (xored_fix & (xored_fix - 1)) == 0;
-                smudge_fixed += can_fix;
-                if (values[h] != values[k] && !can_fix)
-                    match = false;
-            }
+            const uint64_t *a = masks.line(h);
+            const uint64_t *b = masks.line(k);
+            for (int w = 0; w < masks.words; w++)
+                distance += __builtin_popcountll(a[w] ^ b[w]);
         }
-        if (match && smudge_fixed == max_fixes)
-            return i + 1;
+
+        if (distance == smudges)
+            return axis;
     }
 
     return 0;
 }
 
+/*
+ * Sums the pattern notes, patterns being split in contiguous chunks across
+ * threads.
+ */
+long long summarizePatterns(const std::vector<Pattern> &patterns, int smudges)
+{
+    size_t thread_count = std::clamp<size_t>(patterns.size() / 64, 1, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<long long> sums(thread_count, 0);
+
+    auto worker = [&](size_t t)
+    {
+        for (size_t i = patterns.size() * t / thread_count; i < patterns.size() * (t + 1) / thread_count; ++i)
+            sums[t] += 100 * evalSymmetryIndex(patterns[i].rows, smudges) + evalSymmetryIndex(patterns[i].cols, smudges);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    return std::accumulate(sums.begin(), sums.end(), 0LL);
+}
+
 std::string part1(std::stringstream &file_content)
 {
-    auto input_values = parseInput(file_content);
-    int sum = std::accumulate(input_values.begin(), input_values.end(), 0, [](int acc, auto &tile)
-                              { return acc + 100 * evalSymmetryIndex(tile.first, 0) + evalSymmetryIndex(tile.second, 0); });
-    return std::to_string(sum);
+    return std::to_string(summarizePatterns(parseInput(file_content), 0));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-    auto input_values = parseInput(file_content);
-    int sum = std::accumulate(input_values.begin(), input_values.end(), 0, [](int acc, auto &tile)
-                              { return acc + 100 * evalSymmetryIndex(tile.first, 1) + evalSymmetryIndex(tile.second, 1); });
-    return std::to_string(sum);
-}
\ No newline at end of file
+    return std::to_string(summarizePatterns(parseInput(file_content), 1));
+}
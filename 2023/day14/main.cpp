@@ -11,7 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
-#include <unordered_set>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -97,146 +99,226 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-std::vector<std::string> parseInput(std::stringstream &file_content)
+/*
+ * Rocks are kept as bitboards, one bit per cell, either row by row or column
+ * by column. Walls never move, so the stretches between them (segments) are
+ * computed once; a tilt only counts the rocks of each segment and packs them
+ * at one end. Between tilts of different axes the rocks are transposed.
+ *
+ * After the east tilt of a spin, the state is fully given by the rock count
+ * of every row segment, so it is fingerprinted by two random linear hashes of
+ * those counts, accumulated while tilting.
+ */
+
+struct Bitboard
 {
-    std::vector<std::string> input;
-    std::string line;
-    while (std::getline(file_content, line))
-    {
-        input.push_back(line);
-    }
+    int lines = 0;
+    int words = 0;
+    std::vector<uint64_t> bits;
+
+    Bitboard(int line_count = 0, int length = 0) : lines(line_count), words((length + 63) / 64), bits((size_t)line_count * words, 0) {}
+
+    uint64_t *line(int i) { return bits.data() + (size_t)i * words; }
+    const uint64_t *line(int i) const { return bits.data() + (size_t)i * words; }
+    void set(int i, int pos) { line(i)[pos / 64] |= uint64_t(1) << (pos % 64); }
+};
+
+struct Segment
+{
+    int line;
+    int begin;
+    int end;
+};
+
+struct Fingerprint
+{
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const Fingerprint &other) const { return low == other.low && high == other.high; }
+};
+
+struct FingerprintHash
+{
+    size_t operator()(const Fingerprint &fingerprint) const { return fingerprint.low ^ (fingerprint.high * 0x9E3779B97F4A7C15ULL); }
+};
+
+struct Platform
+{
+    int rows = 0;
+    int cols = 0;
+    Bitboard by_row;
+    Bitboard by_col;
+    std::vector<Segment> row_segments;
+    std::vector<Segment> col_segments;
+};
+
+inline uint64_t mix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Mask of the bits [begin, end) that fall in word w
+inline uint64_t wordMask(int w, int begin, int end)
+{
+    int lo = std::max(begin - w * 64, 0);
+    int hi = std::min(end - w * 64, 64);
+    if (lo >= hi)
+        return 0;
+    uint64_t upper = hi == 64 ? ~uint64_t(0) : (uint64_t(1) << hi) - 1;
+    return upper & ~((uint64_t(1) << lo) - 1);
+}
 
-    return input;
+int countRange(const uint64_t *line, int begin, int end)
+{
+    int count = 0;
+    for (int w = begin / 64; w * 64 < end; ++w)
+        count += __builtin_popcountll(line[w] & wordMask(w, begin, end));
+    return count;
 }
 
-void rollNorth(std::vector<std::string> &input)
+void assignRange(uint64_t *line, int begin, int end, int fill_begin, int fill_end)
 {
-    int rows = input.size();
-    int cols = input[0].size();
-    std::vector<int> cursors(cols, 0);
-    for (int col = 0; col < cols; col++)
+    for (int w = begin / 64; w * 64 < end; ++w)
+        line[w] = (line[w] & ~wordMask(w, begin, end)) | wordMask(w, fill_begin, fill_end);
+}
+
+std::vector<Segment> findSegments(const std::vector<std::string> &input, bool by_column)
+{
+    std::vector<Segment> segments;
+    int lines = by_column ? input[0].size() : input.size();
+    int length = by_column ? input.size() : input[0].size();
+
+    for (int i = 0; i < lines; ++i)
     {
-        for (int row = 0; row < rows; row++)
+        int begin = 0;
+        for (int pos = 0; pos <= length; ++pos)
         {
-            auto &c = cursors[col];
-            if (input[row][col] == '#')
-            {
-                c = row + 1;
-            }
-            else if (input[row][col] == 'O')
-            {
-                std::swap(input[row][col], input[c][col]);
-                c++;
-            }
+            if (pos < length && (by_column ? input[pos][i] : input[i][pos]) != '#')
+                continue;
+            if (pos > begin)
+                segments.push_back({i, begin, pos});
+            begin = pos + 1;
         }
     }
+
+    return segments;
 }
 
-void rollSouth(std::vector<std::string> &input)
+Platform parseInput(std::stringstream &file_content)
 {
-    int rows = input.size();
-    int cols = input[0].size();
-    std::vector<int> cursors(cols, rows - 1);
-    for (int col = 0; col < cols; col++)
+    std::vector<std::string> input;
+    for (std::string line; std::getline(file_content, line);)
     {
-        for (int row = rows - 1; row >= 0; row--)
-        {
-            auto &c = cursors[col];
-            if (input[row][col] == '#')
-            {
-                c = row - 1;
-            }
-            else if (input[row][col] == 'O')
-            {
-                std::swap(input[row][col], input[c][col]);
-                c--;
-            }
-        }
+        if (!line.empty())
+            input.push_back(line);
     }
+
+    Platform platform;
+    platform.rows = input.size();
+    platform.cols = input[0].size();
+    platform.by_row = Bitboard(platform.rows, platform.cols);
+    platform.by_col = Bitboard(platform.cols, platform.rows);
+    platform.row_segments = findSegments(input, false);
+    platform.col_segments = findSegments(input, true);
+
+    for (int row = 0; row < platform.rows; ++row)
+        for (int col = 0; col < platform.cols; ++col)
+            if (input[row][col] == 'O')
+                platform.by_row.set(row, col);
+
+    return platform;
 }
 
-void rollWest(std::vector<std::string> &input)
+void transpose(const Bitboard &source, Bitboard &target)
 {
-    int rows = input.size();
-    int cols = input[0].size();
-    std::vector<int> cursors(rows, 0);
-    for (int row = 0; row < rows; row++)
+    std::fill(target.bits.begin(), target.bits.end(), 0);
+    for (int i = 0; i < source.lines; ++i)
     {
-        for (int col = 0; col < cols; col++)
+        const uint64_t *line = source.line(i);
+        for (int w = 0; w < source.words; ++w)
         {
-            auto &c = cursors[row];
-            if (input[row][col] == '#')
-            {
-                c = col + 1;
-            }
-            else if (input[row][col] == 'O')
-            {
-                std::swap(input[row][col], input[row][c]);
-                c++;
-            }
+            for (uint64_t bits = line[w]; bits; bits &= bits - 1)
+                target.set(w * 64 + __builtin_ctzll(bits), i);
         }
     }
 }
 
-void rollEast(std::vector<std::string> &input)
+void tilt(Bitboard &board, const std::vector<Segment> &segments, bool toward_start, Fingerprint *fingerprint = nullptr)
 {
-    int rows = input.size();
-    int cols = input[0].size();
-    std::vector<int> cursors(rows, cols - 1);
-    for (int row = 0; row < rows; row++)
+    for (size_t s = 0; s < segments.size(); ++s)
     {
-        for (int col = cols - 1; col >= 0; col--)
+        const Segment &segment = segments[s];
+        uint64_t *line = board.line(segment.line);
+        int count = countRange(line, segment.begin, segment.end);
+        if (toward_start)
+            assignRange(line, segment.begin, segment.end, segment.begin, segment.begin + count);
+        else
+            assignRange(line, segment.begin, segment.end, segment.end - count, segment.end);
+
+        if (fingerprint)
         {
-            auto &c = cursors[row];
-            if (input[row][col] == '#')
-            {
-                c = col - 1;
-            }
-            else if (input[row][col] == 'O')
-            {
-                std::swap(input[row][col], input[row][c]);
-                c--;
-            }
+            fingerprint->low += count * mix(2 * s);
+            fingerprint->high += count * mix(2 * s + 1);
         }
     }
 }
 
-int calculateLoad(std::vector<std::string> &input)
+// Load on the north beams, from the row bitboard
+long long calculateLoad(const Platform &platform)
 {
-    int rows = input.size();
-    int cols = input[0].size();
-    int sum = 0;
-    for (int col = 0; col < cols; col++)
-        for (int row = 0; row < rows; row++)
-            if (input[row][col] == 'O')
-                sum += rows - row;
-
+    long long sum = 0;
+    for (int row = 0; row < platform.rows; ++row)
+        sum += (long long)countRange(platform.by_row.line(row), 0, platform.cols) * (platform.rows - row);
     return sum;
 }
 
+Fingerprint spin(Platform &platform)
+{
+    Fingerprint fingerprint;
+    transpose(platform.by_row, platform.by_col);
+    tilt(platform.by_col, platform.col_segments, true);
+    transpose(platform.by_col, platform.by_row);
+    tilt(platform.by_row, platform.row_segments, true);
+    transpose(platform.by_row, platform.by_col);
+    tilt(platform.by_col, platform.col_segments, false);
+    transpose(platform.by_col, platform.by_row);
+    tilt(platform.by_row, platform.row_segments, false, &fingerprint);
+    return fingerprint;
+}
+
 std::string part1(std::stringstream &file_content)
 {
-    std::vector<std::string> input = parseInput(file_content);
-    rollNorth(input);
-    return std::to_string(calculateLoad(input));
+    Platform platform = parseInput(file_content);
+    transpose(platform.by_row, platform.by_col);
+    tilt(platform.by_col, platform.col_segments, true);
+    transpose(platform.by_col, platform.by_row);
+    return std::to_string(calculateLoad(platform));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-    std::vector<std::string> input = parseInput(file_content);
-    std::unordered_map<std::string, int> occurences;
-    for (int i = 0; i < 10000000; ++i)
+    constexpr long long SPINS = 1000000000;
+
+    Platform platform = parseInput(file_content);
+    std::unordered_map<Fingerprint, long long, FingerprintHash> seen;
+    std::vector<long long> loads = {calculateLoad(platform)};
+
+    for (long long i = 1; i <= SPINS; ++i)
     {
-        rollNorth(input);
-        rollWest(input);
-        rollSouth(input);
-        rollEast(input);
-
-        std::string key = std::accumulate(input.begin(), input.end(), std::string());
-        if (occurences[key] && ((1000000000 - 1 - occurences[key]) % (i - occurences[key]) == 0))
-            return std::to_string(calculateLoad(input));
-        occurences[key] = i;
+        Fingerprint fingerprint = spin(platform);
+        loads.push_back(calculateLoad(platform));
+
+        auto [it, inserted] = seen.emplace(fingerprint, i);
+        if (!inserted)
+        {
+            long long first = it->second;
+            return std::to_string(loads[first + (SPINS - first) % (i - first)]);
+        }
     }
 
-    return "";
+    return std::to_string(loads.back());
 }
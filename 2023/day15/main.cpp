@@ -11,7 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
-#include <map>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
 
 /*************
  * Setup code  - Solution after line 97
@@ -97,99 +99,209 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-unsigned char hashString(std::string &input)
+/*
+ * The sequence is split into string_views over the input, without copying
+ * any step. HASH is computed for 16 steps at once: lanes are laid out side by
+ * side and updated with a branch-free select, so the loop vectorizes.
+ */
+
+constexpr size_t HASH_LANES = 16;
+
+std::vector<std::string_view> splitSteps(std::string_view input)
+{
+    std::vector<std::string_view> steps;
+    while (!input.empty())
+    {
+        size_t comma = input.find(',');
+        std::string_view step = input.substr(0, comma);
+        while (!step.empty() && (step.back() == '\n' || step.back() == '\r'))
+            step.remove_suffix(1);
+        if (!step.empty())
+            steps.push_back(step);
+        if (comma == std::string_view::npos)
+            break;
+        input.remove_prefix(comma + 1);
+    }
+    return steps;
+}
+
+std::vector<uint8_t> hashStrings(const std::vector<std::string_view> &strings)
 {
-    return std::accumulate(input.begin(), input.end(), 0, [](unsigned char hash, unsigned char c)
-                           { return 17 * (hash + c); });
+    std::vector<uint8_t> hashes(strings.size());
+
+    for (size_t first = 0; first < strings.size(); first += HASH_LANES)
+    {
+        size_t lanes = std::min(HASH_LANES, strings.size() - first);
+        uint8_t hash[HASH_LANES] = {0};
+        size_t max_length = 0;
+        for (size_t lane = 0; lane < lanes; ++lane)
+            max_length = std::max(max_length, strings[first + lane].size());
+
+        for (size_t pos = 0; pos < max_length; ++pos)
+        {
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                const std::string_view &string = strings[first + lane];
+                bool active = pos < string.size();
+                uint8_t c = active ? string[pos] : 0;
+                uint8_t next = (hash[lane] + c) * 17;
+                hash[lane] = active ? next : hash[lane];
+            }
+        }
+
+        std::copy(hash, hash + lanes, hashes.begin() + first);
+    }
+
+    return hashes;
 }
 
 std::string part1(std::stringstream &file_content)
 {
-    int sum = 0;
-    for (std::string step; std::getline(file_content, step, ',');)
-        sum += hashString(step);
+    const std::string input = file_content.str();
+    std::vector<uint8_t> hashes = hashStrings(splitSteps(input));
+    long long sum = std::accumulate(hashes.begin(), hashes.end(), 0LL);
     return std::to_string(sum);
 }
 
 #define DELETION_OP '-'
 #define INSERTION_OP '='
 
-struct step_t
+/*
+ * Lenses live in an append-only log, in insertion order. An open-addressing
+ * table maps a label to its log entry; removals leave a tombstone in the
+ * table and mark the log entry dead, so the final slot order of every box is
+ * read back with one pass over the log.
+ */
+struct lens_t
 {
-    std::string label;
-    char op;
+    std::string_view label;
+    uint8_t box;
     int value;
+    bool alive;
 };
 
-struct box_t
+class LensTable
 {
-    std::string label;
-    int value;
-};
+public:
+    static constexpr int32_t EMPTY = -1;
+    static constexpr int32_t TOMBSTONE = -2;
 
-step_t parseStep(std::string &step)
-{
-    std::string label;
-    char op = 0;
-    int value = 0;
-    for (char c : step)
+    LensTable() : slots(64, EMPTY) {}
+
+    void insert(std::string_view label, uint8_t box, int value)
     {
-        if (c == DELETION_OP || c == INSERTION_OP)
+        size_t slot = findSlot(label);
+        if (slots[slot] >= 0)
         {
-            op = c;
-            continue;
+            log[slots[slot]].value = value;
+            return;
         }
-        if (op)
-            value = value * 10 + c - '0';
-        else
-            label += c;
+
+        if ((used + 1) * 2 > slots.size())
+        {
+            rehash(slots.size() * 2);
+            slot = findSlot(label);
+        }
+
+        used += slots[slot] == EMPTY;
+        slots[slot] = log.size();
+        log.push_back({label, box, value, true});
     }
-    return {label, op, value};
-}
 
-std::string part2(std::stringstream &file_content)
-{
+    void erase(std::string_view label)
+    {
+        size_t slot = findSlot(label);
+        if (slots[slot] < 0)
+            return;
+        log[slots[slot]].alive = false;
+        slots[slot] = TOMBSTONE;
+    }
 
-    std::map<int, std::vector<box_t>> registers;
-    for (std::string step_line; std::getline(file_content, step_line, ',');)
+    long long focusingPower() const
     {
+        long long power = 0;
+        int box_slots[256] = {0};
+        for (const lens_t &lens : log)
+        {
+            if (lens.alive)
+                power += (long long)(lens.box + 1) * (++box_slots[lens.box]) * lens.value;
+        }
+        return power;
+    }
 
-        step_t step = parseStep(step_line);
+private:
+    std::vector<int32_t> slots;
+    std::vector<lens_t> log;
+    size_t used = 0;
 
-        if (step.op == DELETION_OP)
+    static uint64_t labelHash(std::string_view label)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : label)
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        return hash;
+    }
+
+    // Slot holding the label, or the first free slot (tombstone first) of its probe sequence
+    size_t findSlot(std::string_view label) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t free_slot = SIZE_MAX;
+        for (size_t slot = labelHash(label) & mask;; slot = (slot + 1) & mask)
         {
-            std::vector<box_t> &reg = registers[hashString(step.label)];
-            std::vector<box_t>::iterator current_box_it = std::find_if(reg.begin(), reg.end(), [step](box_t &box)
-                                                                       { return box.label == step.label; });
-            bool current_box_exists = current_box_it != reg.end();
-            if (current_box_exists)
-                reg.erase(current_box_it);
+            int32_t entry = slots[slot];
+            if (entry == EMPTY)
+                return free_slot != SIZE_MAX ? free_slot : slot;
+            if (entry == TOMBSTONE)
+                free_slot = free_slot != SIZE_MAX ? free_slot : slot;
+            else if (log[entry].label == label)
+                return slot;
         }
-        else
-        {
-            std::vector<box_t> &reg = registers[hashString(step.label)];
-            std::vector<box_t>::iterator current_box_it = std::find_if(reg.begin(), reg.end(), [step](box_t &box)
-                                                                       { return box.label == step.label; });
-
-            bool current_box_exists = current_box_it != reg.end();
+    }
 
-            if (current_box_exists)
-                current_box_it->value = step.value;
-            else
-                registers[hashString(step.label)].push_back({step.label, step.value});
+    void rehash(size_t capacity)
+    {
+        slots.assign(capacity, EMPTY);
+        used = 0;
+        for (size_t i = 0; i < log.size(); ++i)
+        {
+            if (!log[i].alive)
+                continue;
+            size_t slot = labelHash(log[i].label) & (capacity - 1);
+            while (slots[slot] != EMPTY)
+                slot = (slot + 1) & (capacity - 1);
+            slots[slot] = i;
+            used++;
         }
     }
+};
+
+std::string part2(std::stringstream &file_content)
+{
+    const std::string input = file_content.str();
+    std::vector<std::string_view> steps = splitSteps(input);
+    std::vector<std::string_view> labels(steps.size());
+    std::vector<int> values(steps.size(), 0);
 
-    int sum_forces = 0;
-    for (std::pair<const int, std::vector<box_t>> &reg : registers)
+    for (size_t i = 0; i < steps.size(); ++i)
     {
-        int slot = 0;
-        int box = reg.first;
-        std::vector<box_t> &content = reg.second;
+        size_t op = steps[i].find_first_of("-=");
+        labels[i] = steps[i].substr(0, op);
+        for (size_t pos = op + 1; pos < steps[i].size(); ++pos)
+            values[i] = values[i] * 10 + (steps[i][pos] - '0');
+    }
 
-        for (box_t &box_content : content)
-            sum_forces += box_content.value * (box + 1) * (++slot);
+    std::vector<uint8_t> boxes = hashStrings(labels);
+    LensTable lenses;
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        if (labels[i].size() == steps[i].size())
+            continue;
+        if (steps[i][labels[i].size()] == DELETION_OP)
+            lenses.erase(labels[i]);
+        else
+            lenses.insert(labels[i], boxes[i], values[i]);
     }
 
-    return std::to_string(sum_forces);
+    return std::to_string(lenses.focusingPower());
 }
@@ -11,8 +11,10 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
-#include <queue>
-#include <unordered_set>
+#include <array>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -109,141 +111,355 @@ std::vector<std::string> parseInput(std::stringstream &file_content)
     std::string line;
     while (std::getline(file_content, line))
     {
-        input.push_back(line);
+        if (!line.empty())
+            input.push_back(line);
     }
     return input;
 }
 
-std::vector<std::array<int, 2>> directions = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+const std::array<std::array<int, 2>, 4> directions = {{{0, 1}, {1, 0}, {0, -1}, {-1, 0}}};
+
+/*
+ * A beam travels straight until it reaches a cell that turns it: a mirror or
+ * a splitter hit on its flat side. Every (turning cell, outgoing direction)
+ * pair is a node of a graph, holding the straight segment the beam covers
+ * and the nodes it turns into at the end of the segment.
+ *
+ * Loops are collapsed with Tarjan's SCC algorithm. An entry point is one
+ * segment plus everything reachable in the condensed DAG, which is walked
+ * with a per-thread visit stamp into a per-thread cell bitset. A full-grid
+ * bitset per component would need memory quadratic in the grid, so only the
+ * largest non-trivial components memoize their reachable cells, within a
+ * fixed memory budget, and the walk stops at them.
+ */
+
+struct Segment
+{
+    int row = 0;
+    int col = 0;
+    int direction = 0;
+    int length = 0;
+    std::array<int, 2> next = {-1, -1};
+};
+
+struct BeamGraph
+{
+    int rows = 0;
+    int cols = 0;
+    int words = 0;
+    std::vector<std::string> map;
+    std::vector<int> turning_id;
+    std::vector<Segment> segments;
+    std::vector<int> component;
+
+    // Per component, CSR: member segments and successor components
+    std::vector<int> member_offsets, members;
+    std::vector<int> successor_offsets, successors;
+
+    // Memoized reachable cells, for the components with a slot
+    std::vector<int> closure_slot;
+    std::vector<uint64_t> closures;
+
+    const uint64_t *closure(int slot) const { return closures.data() + (size_t)slot * words; }
+};
+
+// Upper bound on memoized closure bits, 64 MB
+constexpr size_t CLOSURE_CACHE_BITS = size_t(1) << 29;
+
+struct WalkScratch
+{
+    std::vector<uint64_t> cells;
+    std::vector<int> stamp;
+    std::vector<int> stack;
+    int epoch = 0;
 
-int getStateKey(std::tuple<int, int, int> state)
+    explicit WalkScratch(const BeamGraph &graph) : cells(graph.words, 0), stamp(graph.closure_slot.size(), 0) {}
+};
+
+inline bool turnsBeam(char tile, int direction)
 {
-    return std::get<0>(state) + std::get<1>(state) * 1000 + std::get<2>(state) * 1000000;
+    return tile == '/' || tile == '\\' || (tile == '|' && direction % 2 == 0) || (tile == '-' && direction % 2 == 1);
 }
 
-void insertNewPosition(std::vector<std::string> &input_map, int current_x, int current_y, int direction, std::queue<std::tuple<int, int, int>> &positions, std::unordered_set<int> &visited)
+std::array<int, 2> outgoingDirections(char tile, int direction)
 {
-    int new_direction = direction;
-    int ny = current_y + directions[new_direction][0];
-    int nx = current_x + directions[new_direction][1];
-    if (nx < 0 || ny < 0 || ny >= (int)input_map.size() || nx >= (int)input_map[ny].size())
-        return;
-    if (visited.find(getStateKey({ny, nx, new_direction})) != visited.end())
-        return;
+    switch (tile)
+    {
+    case '\\':
+        return {direction % 2 == 0 ? (direction + 1) % 4 : (direction + 3) % 4, -1};
+    case '/':
+        return {direction % 2 == 0 ? (direction + 3) % 4 : (direction + 1) % 4, -1};
+    case '|':
+        return {D_DOWN, D_UP};
+    default:
+        return {D_RIGHT, D_LEFT};
+    }
+}
 
-    positions.push({ny, nx, new_direction});
-    visited.insert(getStateKey({ny, nx, new_direction}));
+// Segment of a beam entering (row, col) heading in direction, the cell included
+Segment walkSegment(const BeamGraph &graph, int row, int col, int direction)
+{
+    Segment segment{row, col, direction};
+    while (row >= 0 && col >= 0 && row < graph.rows && col < graph.cols)
+    {
+        segment.length++;
+        char tile = graph.map[row][col];
+        if (turnsBeam(tile, direction))
+        {
+            auto outs = outgoingDirections(tile, direction);
+            int base = graph.turning_id[row * graph.cols + col] * 4;
+            for (int i = 0; i < 2; ++i)
+                segment.next[i] = outs[i] < 0 ? -1 : base + outs[i];
+            break;
+        }
+        row += directions[direction][0];
+        col += directions[direction][1];
+    }
+    return segment;
 }
 
-int getEnergy(std::vector<std::string> &input_map, int y, int x, int direction)
+void setSegmentBits(const BeamGraph &graph, const Segment &segment, uint64_t *bits)
 {
-    std::tuple<int, int, int> position_direction = {y, x, direction};
-    std::queue<std::tuple<int, int, int>> positions;
-    std::unordered_set<int> visited_state;
-    std::unordered_set<int> visited_pos;
-    positions.push(position_direction);
-    visited_state.insert(getStateKey(position_direction));
+    int row = segment.row, col = segment.col;
+    for (int i = 0; i < segment.length; ++i)
+    {
+        int cell = row * graph.cols + col;
+        bits[cell / 64] |= uint64_t(1) << (cell % 64);
+        row += directions[segment.direction][0];
+        col += directions[segment.direction][1];
+    }
+}
 
-    int total_energy = 0;
-    while (!positions.empty())
+// Sets the cells reachable from the given components, stopping at memoized ones
+void markReachable(const BeamGraph &graph, const int *roots, int root_count, WalkScratch &scratch)
+{
+    int epoch = ++scratch.epoch;
+    scratch.stack.assign(roots, roots + root_count);
+    while (!scratch.stack.empty())
     {
-        auto [y, x, direction] = positions.front();
-        positions.pop();
-        if (visited_pos.find(getStateKey({y, x, 0})) == visited_pos.end())
-            total_energy++;
-        visited_pos.insert(getStateKey({y, x, 0}));
+        int c = scratch.stack.back();
+        scratch.stack.pop_back();
+        if (scratch.stamp[c] == epoch)
+            continue;
+        scratch.stamp[c] = epoch;
 
-        if (input_map[y][x] == '.' || (input_map[y][x] == '|' && (direction % 2 == 1)) || (input_map[y][x] == '-' && (direction % 2 == 0)))
+        if (graph.closure_slot[c] >= 0)
         {
-            insertNewPosition(input_map, x, y, direction, positions, visited_state);
+            const uint64_t *bits = graph.closure(graph.closure_slot[c]);
+            for (int w = 0; w < graph.words; ++w)
+                scratch.cells[w] |= bits[w];
+            continue;
         }
-        else if (input_map[y][x] == '|')
-        {
 
-            insertNewPosition(input_map, x, y, 1, positions, visited_state);
-            insertNewPosition(input_map, x, y, 3, positions, visited_state);
-        }
-        else if (input_map[y][x] == '-')
-        {
+        for (int m = graph.member_offsets[c]; m < graph.member_offsets[c + 1]; ++m)
+            setSegmentBits(graph, graph.segments[graph.members[m]], scratch.cells.data());
+        for (int e = graph.successor_offsets[c]; e < graph.successor_offsets[c + 1]; ++e)
+            if (scratch.stamp[graph.successors[e]] != epoch)
+                scratch.stack.push_back(graph.successors[e]);
+    }
+}
 
-            insertNewPosition(input_map, x, y, 0, positions, visited_state);
-            insertNewPosition(input_map, x, y, 2, positions, visited_state);
-        }
-        else if (input_map[y][x] == '\\')
+// Iterative Tarjan; components are numbered in the order they complete
+void findComponents(BeamGraph &graph)
+{
+    int node_count = graph.segments.size();
+    std::vector<int> index(node_count, -1), low(node_count, 0);
+    std::vector<bool> on_stack(node_count, false);
+    std::vector<int> stack;
+    std::vector<std::pair<int, int>> call_stack;
+    int next_index = 0, component_count = 0;
+    graph.component.assign(node_count, -1);
+
+    for (int root = 0; root < node_count; ++root)
+    {
+        if (index[root] >= 0)
+            continue;
+        call_stack.push_back({root, 0});
+
+        while (!call_stack.empty())
         {
-            int new_direction = direction % 2 == 0 ? (4 + direction + 1) % 4 : (4 + direction - 1) % 4;
-            insertNewPosition(input_map, x, y, new_direction, positions, visited_state);
+            auto &[node, edge] = call_stack.back();
+            if (edge == 0)
+            {
+                index[node] = low[node] = next_index++;
+                stack.push_back(node);
+                on_stack[node] = true;
+            }
+
+            if (edge < 2)
+            {
+                int next = graph.segments[node].next[edge++];
+                if (next < 0)
+                    continue;
+                if (index[next] < 0)
+                    call_stack.push_back({next, 0});
+                else if (on_stack[next])
+                    low[node] = std::min(low[node], index[next]);
+                continue;
+            }
+
+            int finished = node;
+            call_stack.pop_back();
+            if (low[finished] == index[finished])
+            {
+                int member;
+                do
+                {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = false;
+                    graph.component[member] = component_count;
+                } while (member != finished);
+                component_count++;
+            }
+            if (!call_stack.empty())
+            {
+                int parent = call_stack.back().first;
+                low[parent] = std::min(low[parent], low[finished]);
+            }
         }
-        else if (input_map[y][x] == '/')
+    }
+
+    auto buildCsr = [&](std::vector<int> &offsets, std::vector<int> &values, auto &&forEach)
+    {
+        offsets.assign(component_count + 1, 0);
+        forEach([&](int c, int)
+                { offsets[c + 1]++; });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        values.resize(offsets.back());
+        std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+        forEach([&](int c, int value)
+                { values[fill[c]++] = value; });
+    };
+
+    buildCsr(graph.member_offsets, graph.members, [&](auto &&emit)
+             {
+        for (int node = 0; node < node_count; ++node)
+            emit(graph.component[node], node); });
+    buildCsr(graph.successor_offsets, graph.successors, [&](auto &&emit)
+             {
+        for (int node = 0; node < node_count; ++node)
+            for (int next : graph.segments[node].next)
+                if (next >= 0 && graph.component[next] != graph.component[node])
+                    emit(graph.component[node], graph.component[next]); });
+
+    // Memoize the largest loops; successors complete first, so filling slots
+    // in component order lets each closure reuse the ones below it
+    std::vector<int> candidates;
+    for (int c = 0; c < component_count; ++c)
+        if (graph.member_offsets[c + 1] - graph.member_offsets[c] > 1)
+            candidates.push_back(c);
+    size_t slot_count = std::min(candidates.size(), CLOSURE_CACHE_BITS / ((size_t)graph.words * 64));
+    auto memberCount = [&](int c)
+    { return graph.member_offsets[c + 1] - graph.member_offsets[c]; };
+    std::partial_sort(candidates.begin(), candidates.begin() + slot_count, candidates.end(), [&](int a, int b)
+                      { return memberCount(a) > memberCount(b); });
+    candidates.resize(slot_count);
+    std::sort(candidates.begin(), candidates.end());
+
+    graph.closure_slot.assign(component_count, -1);
+    graph.closures.assign(slot_count * graph.words, 0);
+    WalkScratch scratch(graph);
+    for (size_t slot = 0; slot < slot_count; ++slot)
+    {
+        int c = candidates[slot];
+        std::fill(scratch.cells.begin(), scratch.cells.end(), 0);
+        markReachable(graph, &c, 1, scratch);
+        std::copy(scratch.cells.begin(), scratch.cells.end(), graph.closures.begin() + slot * graph.words);
+        graph.closure_slot[c] = slot;
+    }
+}
+
+BeamGraph buildBeamGraph(std::vector<std::string> input_map)
+{
+    BeamGraph graph;
+    graph.map = std::move(input_map);
+    graph.rows = graph.map.size();
+    graph.cols = graph.map[0].size();
+    graph.words = (graph.rows * graph.cols + 63) / 64;
+    graph.turning_id.assign(graph.rows * graph.cols, -1);
+
+    int turning_count = 0;
+    for (int row = 0; row < graph.rows; ++row)
+        for (int col = 0; col < graph.cols; ++col)
+            if (graph.map[row][col] != '.')
+                graph.turning_id[row * graph.cols + col] = turning_count++;
+
+    graph.segments.resize(turning_count * 4);
+    for (int row = 0; row < graph.rows; ++row)
+    {
+        for (int col = 0; col < graph.cols; ++col)
         {
-            int new_direction = direction % 2 == 0 ? (4 + direction - 1) % 4 : (4 + direction + 1) % 4;
-            insertNewPosition(input_map, x, y, new_direction, positions, visited_state);
+            int id = graph.turning_id[row * graph.cols + col];
+            if (id < 0)
+                continue;
+            for (int direction = 0; direction < 4; ++direction)
+                graph.segments[id * 4 + direction] = walkSegment(graph, row + directions[direction][0], col + directions[direction][1], direction);
         }
     }
 
-    return total_energy;
+    findComponents(graph);
+    return graph;
+}
+
+int getEnergy(const BeamGraph &graph, int y, int x, int direction, WalkScratch &scratch)
+{
+    Segment segment = walkSegment(graph, y, x, direction);
+    std::fill(scratch.cells.begin(), scratch.cells.end(), 0);
+    setSegmentBits(graph, segment, scratch.cells.data());
+
+    std::array<int, 2> roots;
+    int root_count = 0;
+    for (int next : segment.next)
+        if (next >= 0)
+            roots[root_count++] = graph.component[next];
+    markReachable(graph, roots.data(), root_count, scratch);
+
+    int energy = 0;
+    for (uint64_t word : scratch.cells)
+        energy += __builtin_popcountll(word);
+    return energy;
 }
 
 std::string part1(std::stringstream &file_content)
 {
-    auto input_map = parseInput(file_content);
-    return std::to_string(getEnergy(input_map, 0, 0, D_RIGHT));
+    BeamGraph graph = buildBeamGraph(parseInput(file_content));
+    WalkScratch scratch(graph);
+    return std::to_string(getEnergy(graph, 0, 0, D_RIGHT, scratch));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-    auto input_map = parseInput(file_content);
-    int max_energy = 0;
-    for (int col = 0; col < (int)input_map[0].size(); col++)
-    {
-
-        if (col == 0)
-        {
-            max_energy = std::max(getEnergy(input_map, 0, 0, D_DOWN), max_energy);
-            max_energy = std::max(getEnergy(input_map, 0, 0, D_RIGHT), max_energy);
-
-            max_energy = std::max(getEnergy(input_map, (int)input_map.size() - 1, 0, D_RIGHT), max_energy);
-            max_energy = std::max(getEnergy(input_map, (int)input_map.size() - 1, 0, D_UP), max_energy);
-        }
-        else if (col == (int)input_map[0].size() - 1)
-        {
-            max_energy = std::max(getEnergy(input_map, 0, col, D_DOWN), max_energy);
-            max_energy = std::max(getEnergy(input_map, 0, col, D_LEFT), max_energy);
+    BeamGraph graph = buildBeamGraph(parseInput(file_content));
 
-            max_energy = std::max(getEnergy(input_map, (int)input_map.size() - 1, col, D_LEFT), max_energy);
-            max_energy = std::max(getEnergy(input_map, (int)input_map.size() - 1, col, D_UP), max_energy);
-        }
-        else
-        {
-            max_energy = std::max(getEnergy(input_map, 0, col, D_DOWN), max_energy);
-            max_energy = std::max(getEnergy(input_map, (int)input_map.size() - 1, col, D_UP), max_energy);
-        }
+    std::vector<std::array<int, 3>> entries;
+    for (int col = 0; col < graph.cols; col++)
+    {
+        entries.push_back({0, col, D_DOWN});
+        entries.push_back({graph.rows - 1, col, D_UP});
     }
-
-    for (int row = 0; row < (int)input_map.size(); row++)
+    for (int row = 0; row < graph.rows; row++)
     {
-        if (row == 0)
-        {
-            max_energy = std::max(getEnergy(input_map, row, 0, D_RIGHT), max_energy);
-            max_energy = std::max(getEnergy(input_map, row, 0, D_DOWN), max_energy);
-
-            max_energy = std::max(getEnergy(input_map, row, (int)input_map[0].size() - 1, D_DOWN), max_energy);
-            max_energy = std::max(getEnergy(input_map, row, (int)input_map[0].size() - 1, D_LEFT), max_energy);
-        }
-        else if (row == (int)input_map.size() - 1)
-        {
-            max_energy = std::max(getEnergy(input_map, row, 0, D_RIGHT), max_energy);
-            max_energy = std::max(getEnergy(input_map, row, 0, D_UP), max_energy);
-
-            max_energy = std::max(getEnergy(input_map, row, (int)input_map[0].size() - 1, D_LEFT), max_energy);
-            max_energy = std::max(getEnergy(input_map, row, (int)input_map[0].size() - 1, D_UP), max_energy);
-        }
-        else
-        {
-            max_energy = std::max(getEnergy(input_map, row, 0, D_RIGHT), max_energy);
-            max_energy = std::max(getEnergy(input_map, row, (int)input_map[0].size() - 1, D_LEFT), max_energy);
-        }
+        entries.push_back({row, 0, D_RIGHT});
+        entries.push_back({row, graph.cols - 1, D_LEFT});
     }
 
-    return std::to_string(max_energy);
+    size_t thread_count = std::clamp<size_t>(entries.size() / 64, 1, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<int> max_energies(thread_count, 0);
+
+    auto worker = [&](size_t t)
+    {
+        WalkScratch scratch(graph);
+        for (size_t i = entries.size() * t / thread_count; i < entries.size() * (t + 1) / thread_count; ++i)
+            max_energies[t] = std::max(max_energies[t], getEnergy(graph, entries[i][0], entries[i][1], entries[i][2], scratch));
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    return std::to_string(*std::max_element(max_energies.begin(), max_energies.end()));
 }
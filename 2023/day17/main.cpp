@@ -9,8 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <algorithm>
-#include <queue>
-#include <unordered_map>
+#include <cstdint>
+#include <climits>
 
 /*************
  * Setup code
@@ -102,174 +102,99 @@ std::vector<std::string> parseInput(std::stringstream &file_content)
     std::string line;
     while (std::getline(file_content, line))
     {
-        input.push_back(line);
+        if (!line.empty())
+            input.push_back(line);
     }
     return input;
 }
 
+#define MIN_STRAIGHT_COUNT 1
 #define MAX_STRAIGHT_COUNT 3
-#define MAX_STRAIGHT_COUNT_P2 10
 #define MIN_STRAIGHT_COUNT_P2 4
-struct state_t
-{
-    std::array<int, 2> pos;
-    std::array<int, 2> dir;
-    int straight_count;
-    int heat_loss;
-};
-
-bool is_valid_pos(const std::vector<std::string> &input_map, const std::array<int, 2> &pos)
-{
-    return pos[0] >= 0 && pos[0] < (int)input_map.size() && pos[1] >= 0 && pos[1] < (int)input_map[0].size();
-}
-
-std::array<int, 2> turn_left(const std::array<int, 2> &dir)
-{
-    return {-dir[1], dir[0]};
-}
-
-std::array<int, 2> turn_right(const std::array<int, 2> &dir)
-{
-    return {dir[1], -dir[0]};
-}
-
-bool cmp(const state_t &a, const state_t &b)
-{
-    return a.heat_loss > b.heat_loss;
-}
+#define MAX_STRAIGHT_COUNT_P2 10
 
-void enqueueState(const std::vector<std::string> &input_map, std::priority_queue<state_t, std::vector<state_t>, decltype(&cmp)> &queue, std::unordered_map<int, int> &visited_loss, const std::array<int, 2> &next_pos, const std::array<int, 2> &next_dir, int next_straight_count, int heat_loss)
+/*
+ * A state is a cell plus the axis of the run that just ended there (0 for
+ * vertical, 1 for horizontal): the next move must turn. Popping a state
+ * expands every run of min_run..max_run cells on the other axis at once, so
+ * no straight counter is needed and costs fit a dense (row, col, axis) array.
+ *
+ * Heat loss per cell is 1-9, so a run costs at most 9 * max_run. Dijkstra
+ * runs on a circular bucket queue with that many + 1 buckets.
+ */
+int minimalHeatLoss(const std::vector<std::string> &input_map, int min_run, int max_run)
 {
-    if (!is_valid_pos(input_map, next_pos))
+    int rows = input_map.size();
+    int cols = input_map[0].size();
+    std::vector<uint8_t> loss((size_t)rows * cols);
+    for (int row = 0; row < rows; ++row)
+        for (int col = 0; col < cols; ++col)
+            loss[(size_t)row * cols + col] = input_map[row][col] - '0';
+
+    int bucket_count = 9 * max_run + 1;
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    std::vector<int> best((size_t)rows * cols * 2, INT_MAX);
+    size_t queued = 0;
+
+    auto push = [&](uint32_t state, int cost)
     {
-        return;
-    }
-
-    int next_heat_loss = heat_loss + (input_map[next_pos[0]][next_pos[1]] - '0');
-    int key = next_pos[0] * 1000000 + next_pos[1] * 1000 + (1 + next_dir[0]) * 100 + (1 + next_dir[1]) * 10 + next_straight_count;
-    if (visited_loss.find(key) != visited_loss.end() && visited_loss[key] <= next_heat_loss)
+        if (cost >= best[state])
+            return;
+        best[state] = cost;
+        buckets[cost % bucket_count].push_back(state);
+        queued++;
+    };
+
+    push(0, 0);
+    push(1, 0);
+    uint32_t end_cell = (uint32_t)(rows * cols - 1);
+
+    for (int cost = 0; queued > 0; ++cost)
     {
-        return;
+        auto &bucket = buckets[cost % bucket_count];
+        while (!bucket.empty())
+        {
+            uint32_t state = bucket.back();
+            bucket.pop_back();
+            queued--;
+            if (best[state] != cost)
+                continue;
+
+            uint32_t cell = state / 2;
+            if (cell == end_cell)
+                return cost;
+
+            int row = cell / cols, col = cell % cols;
+            int axis = (state % 2) ^ 1;
+            int d_row = axis == 0, d_col = axis == 1;
+
+            for (int sign = -1; sign <= 1; sign += 2)
+            {
+                int run_cost = cost;
+                for (int step = 1; step <= max_run; ++step)
+                {
+                    int next_row = row + sign * step * d_row;
+                    int next_col = col + sign * step * d_col;
+                    if (next_row < 0 || next_row >= rows || next_col < 0 || next_col >= cols)
+                        break;
+                    uint32_t next_cell = (uint32_t)(next_row * cols + next_col);
+                    run_cost += loss[next_cell];
+                    if (step >= min_run)
+                        push(next_cell * 2 + axis, run_cost);
+                }
+            }
+        }
     }
 
-    visited_loss[key] = next_heat_loss;
-    queue.push({next_pos, next_dir, next_straight_count, next_heat_loss});
+    return -1;
 }
 
 std::string part1(std::stringstream &file_content)
 {
-
-    auto input_map = parseInput(file_content);
-
-    std::array<int, 2> ending_pos = {(int)input_map.size() - 1, (int)input_map[0].size() - 1};
-
-    std::priority_queue<state_t, std::vector<state_t>, decltype(&cmp)> queue(cmp);
-    std::unordered_map<int, int> visited_loss;
-    queue.push({{0, 0}, {1, 0}, 0, 0});
-    queue.push({{0, 0}, {0, 1}, 0, 0});
-
-    while (!queue.empty())
-    {
-        auto state = queue.top();
-        queue.pop();
-
-        if (state.pos == ending_pos)
-        {
-
-            return std::to_string(state.heat_loss);
-        }
-
-        {
-            auto next_dir = turn_left(state.dir);
-            auto next_pos = state.pos;
-            auto next_straight_count = 0;
-            next_pos[0] += next_dir[0];
-            next_pos[1] += next_dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-
-        {
-            auto next_dir = turn_right(state.dir);
-            auto next_pos = state.pos;
-            auto next_straight_count = 0;
-            next_pos[0] += next_dir[0];
-            next_pos[1] += next_dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-
-        if (state.straight_count < MAX_STRAIGHT_COUNT - 1)
-        {
-            auto next_pos = state.pos;
-            auto next_dir = state.dir;
-            auto next_straight_count = state.straight_count + 1;
-            next_pos[0] += state.dir[0];
-            next_pos[1] += state.dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-    }
-
-    return "failed";
+    return std::to_string(minimalHeatLoss(parseInput(file_content), MIN_STRAIGHT_COUNT, MAX_STRAIGHT_COUNT));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-
-    auto input_map = parseInput(file_content);
-
-    std::array<int, 2> ending_pos = {(int)input_map.size() - 1, (int)input_map[0].size() - 1};
-
-    std::priority_queue<state_t, std::vector<state_t>, decltype(&cmp)> queue(cmp);
-    std::unordered_map<int, int> visited_loss;
-    queue.push({{0, 0}, {1, 0}, 0, 0});
-    queue.push({{0, 0}, {0, 1}, 0, 0});
-
-    while (!queue.empty())
-    {
-        auto state = queue.top();
-        queue.pop();
-
-        if (state.pos == ending_pos)
-        {
-
-            return std::to_string(state.heat_loss);
-        }
-
-        if (state.straight_count >= MIN_STRAIGHT_COUNT_P2 - 1)
-        {
-            auto next_dir = turn_left(state.dir);
-            auto next_pos = state.pos;
-            auto next_straight_count = 0;
-            next_pos[0] += next_dir[0];
-            next_pos[1] += next_dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-
-        if (state.straight_count >= MIN_STRAIGHT_COUNT_P2 - 1)
-        {
-            auto next_dir = turn_right(state.dir);
-            auto next_pos = state.pos;
-            auto next_straight_count = 0;
-            next_pos[0] += next_dir[0];
-            next_pos[1] += next_dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-
-        if (state.straight_count < MAX_STRAIGHT_COUNT_P2 - 1)
-        {
-            auto next_pos = state.pos;
-            auto next_dir = state.dir;
-            auto next_straight_count = state.straight_count + 1;
-            next_pos[0] += state.dir[0];
-            next_pos[1] += state.dir[1];
-
-            enqueueState(input_map, queue, visited_loss, next_pos, next_dir, next_straight_count, state.heat_loss);
-        }
-    }
-
-    return "failed";
+    return std::to_string(minimalHeatLoss(parseInput(file_content), MIN_STRAIGHT_COUNT_P2, MAX_STRAIGHT_COUNT_P2));
 }
@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -96,96 +99,165 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-struct dig_inst_t
-{
-    char dir;
-    int steps;
-    std::string color;
-};
+/*
+ * The plan is streamed from the input in blocks of whole lines and never
+ * stored as instructions. Both encodings are decoded in the same pass: the
+ * "R 6" part for part 1 and the "(#70c710)" part for part 2.
+ *
+ * A run of instructions is summarized by its displacement, its perimeter and
+ * its shoelace sum taken from its own start. Two runs merge by shifting the
+ * second one to the end of the first, so blocks are split at line boundaries
+ * and reduced in parallel.
+ */
 
-std::vector<dig_inst_t> parse(std::stringstream &file_content)
+using area_t = __int128;
+
+struct LagoonSummary
 {
-    std::vector<dig_inst_t> instructions;
-    std::string line;
-    while (std::getline(file_content, line))
+    area_t twice_area = 0;
+    area_t perimeter = 0;
+    area_t dx = 0;
+    area_t dy = 0;
+
+    void move(int direction, area_t steps)
     {
-        dig_inst_t inst;
-        std::stringstream ss(line);
-        ss >> inst.dir;
-        ss >> inst.steps;
-        ss >> inst.color;
-        inst.color = inst.color.substr(2, inst.color.size() - 3);
-        instructions.push_back(inst);
+        static constexpr int DX[4] = {1, 0, -1, 0};
+        static constexpr int DY[4] = {0, 1, 0, -1};
+        area_t next_x = dx + DX[direction] * steps;
+        area_t next_y = dy + DY[direction] * steps;
+        twice_area += dx * next_y - dy * next_x;
+        perimeter += steps;
+        dx = next_x;
+        dy = next_y;
     }
-    return instructions;
-}
 
-std::string part1(std::stringstream &file_content)
+    void append(const LagoonSummary &next)
+    {
+        twice_area += next.twice_area + dx * next.dy - dy * next.dx;
+        perimeter += next.perimeter;
+        dx += next.dx;
+        dy += next.dy;
+    }
+
+    area_t lagoonSize() const
+    {
+        return (twice_area < 0 ? -twice_area : twice_area) / 2 + perimeter / 2 + 1;
+    }
+};
+
+using lagoon_pair_t = std::array<LagoonSummary, 2>;
+
+inline int hexValue(char c)
 {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
 
-    auto instructions = parse(file_content);
-    std::array<int, 2> pos = {0, 0};
-    std::array<int, 2> prev_pos = {0, 0};
+// Decodes the lines of [begin, end) into the part 1 and part 2 summaries
+lagoon_pair_t summarizeLines(const char *begin, const char *end)
+{
+    lagoon_pair_t summaries;
 
-    int perimeter = 0;
-    int sum = 0;
-    for (const auto &inst : instructions)
+    for (const char *p = begin; p < end;)
     {
-        switch (inst.dir)
+        const char *line_end = std::find(p, end, '\n');
+        if (line_end - p >= 12)
         {
-        case 'R':
-            pos[0] += inst.steps;
-            break;
-        case 'D':
-            pos[1] += inst.steps;
-            break;
-        case 'L':
-            pos[0] -= inst.steps;
-            break;
-        case 'U':
-            pos[1] -= inst.steps;
-            break;
+            int direction = p[0] == 'R' ? 0 : p[0] == 'D' ? 1 : p[0] == 'L' ? 2 : 3;
+            area_t steps = 0;
+            const char *q = p + 2;
+            for (; *q >= '0' && *q <= '9'; ++q)
+                steps = steps * 10 + (*q - '0');
+            summaries[0].move(direction, steps);
+
+            const char *hex = std::find(q, line_end, '#') + 1;
+            area_t hex_steps = 0;
+            for (int i = 0; i < 5; ++i)
+                hex_steps = hex_steps * 16 + hexValue(hex[i]);
+            summaries[1].move(hexValue(hex[5]) % 4, hex_steps);
         }
-        perimeter += inst.steps;
-        sum += prev_pos[0] * pos[1] - prev_pos[1] * pos[0];
-        prev_pos = pos;
+        p = line_end + 1;
     }
 
-    return std::to_string(std::abs(sum + perimeter) / 2 + 1);
+    return summaries;
 }
 
-std::string part2(std::stringstream &file_content)
+lagoon_pair_t summarizeBlock(const std::string &block)
 {
+    constexpr size_t BYTES_PER_THREAD = 1 << 16;
+    size_t thread_count = std::clamp<size_t>(block.size() / BYTES_PER_THREAD, 1, std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<const char *> bounds = {block.data()};
+    for (size_t t = 1; t < thread_count; ++t)
+    {
+        const char *split = std::find(block.data() + block.size() * t / thread_count, block.data() + block.size(), '\n');
+        bounds.push_back(std::max(bounds.back(), std::min(split + 1, block.data() + block.size())));
+    }
+    bounds.push_back(block.data() + block.size());
 
-    auto instructions = parse(file_content);
-    std::array<long long, 2> pos = {0, 0};
-    std::array<long long, 2> prev_pos = {0, 0};
+    std::vector<lagoon_pair_t> partials(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < thread_count; ++t)
+        threads.emplace_back([&, t]
+                             { partials[t] = summarizeLines(bounds[t], bounds[t + 1]); });
+    partials[0] = summarizeLines(bounds[0], bounds[1]);
+    for (auto &thread : threads)
+        thread.join();
 
-    long long perimeter = 0;
-    long long sum = 0;
-    for (const auto &inst : instructions)
+    for (size_t t = 1; t < thread_count; ++t)
+        for (int part = 0; part < 2; ++part)
+            partials[0][part].append(partials[t][part]);
+
+    return partials[0];
+}
+
+lagoon_pair_t summarizePlan(std::stringstream &file_content)
+{
+    constexpr size_t BLOCK_SIZE = 1 << 20;
+    lagoon_pair_t summaries;
+    std::string block;
+    std::vector<char> buffer(BLOCK_SIZE);
+
+    while (true)
     {
-        char dir = "RDLU"[inst.color[inst.color.size() - 1] % 4];
-        int steps = std::stoi(inst.color.substr(0, inst.color.size() - 1), nullptr, 16);
-        switch (dir)
+        std::streamsize read = file_content.rdbuf()->sgetn(buffer.data(), buffer.size());
+        block.append(buffer.data(), read);
+
+        size_t last_line_end = read > 0 ? block.rfind('\n') : block.size() - 1;
+        if (last_line_end != std::string::npos)
         {
-        case 'R':
-            pos[0] += steps;
-            break;
-        case 'D':
-            pos[1] += steps;
-            break;
-        case 'L':
-            pos[0] -= steps;
-            break;
-        case 'U':
-            pos[1] -= steps;
-            break;
+            std::string lines = block.substr(0, last_line_end + 1);
+            lagoon_pair_t block_summaries = summarizeBlock(lines);
+            for (int part = 0; part < 2; ++part)
+                summaries[part].append(block_summaries[part]);
+            block.erase(0, last_line_end + 1);
         }
-        perimeter += steps;
-        sum += prev_pos[0] * pos[1] - prev_pos[1] * pos[0];
-        prev_pos = pos;
+
+        if (read <= 0)
+            break;
     }
 
-    return std::to_string(std::abs(sum + perimeter) / 2 + 1);
+    return summaries;
+}
+
+std::string toString(area_t value)
+{
+    std::string result;
+    bool negative = value < 0;
+    do
+    {
+        int digit = (int)(value % 10);
+        result.insert(result.begin(), char('0' + (negative ? -digit : digit)));
+        value /= 10;
+    } while (value != 0);
+    return negative ? "-" + result : result;
+}
+
+std::string part1(std::stringstream &file_content)
+{
+    return toString(summarizePlan(file_content)[0].lagoonSize());
+}
+
+std::string part2(std::stringstream &file_content)
+{
+    return toString(summarizePlan(file_content)[1].lagoonSize());
 }
@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -95,218 +98,240 @@ int main(int argc, char const *argv[])
 /***************************************
  *              Solutions
  **************************************/
-struct rule_t
+
+/*
+ * Workflows are compiled once into a flat decision tree. Every rule with a
+ * condition becomes a node testing "rating[slot] < threshold" ("a>v" is
+ * stored as "a<v+1" with its branches swapped); leaves are ACCEPT and REJECT.
+ * A part walks the tree with node = next[node][rating >= threshold], with no
+ * string or map lookup.
+ *
+ * For part 2 the tree is partitioned once into the disjoint boxes of
+ * accepted ratings, which answer any range-count query.
+ */
+
+constexpr int ACCEPT = -1;
+constexpr int REJECT = -2;
+constexpr int MIN_RATING = 1;
+constexpr int MAX_RATING = 4000;
+
+using part_t = std::array<int, 4>;
+
+struct decision_node_t
 {
-    char key;
-    char op;
-    int value;
-    std::string next;
+    int slot;
+    int threshold;
+    std::array<int, 2> next;
 };
 
-rule_t parseRule(std::string rule_s)
+struct box_t
 {
-    size_t tok = rule_s.find(':');
-    if (tok == rule_s.npos)
+    std::array<int, 4> low;
+    std::array<int, 4> high;
+
+    unsigned long long volume() const
     {
-        return (rule_t){.key = 0, .op = 0, .value = 0, .next = rule_s};
+        unsigned long long volume = 1;
+        for (int slot = 0; slot < 4; ++slot)
+            volume *= high[slot] > low[slot] ? high[slot] - low[slot] : 0;
+        return volume;
     }
+};
 
-    rule_t rule;
-    rule.key = rule_s[0];
-    rule.op = rule_s[1];
-    rule.value = std::stoi(rule_s.substr(2));
-    rule.next = rule_s.substr(tok + 1);
+struct DecisionTree
+{
+    std::vector<decision_node_t> nodes;
+    int root = REJECT;
+    std::vector<box_t> accepted_boxes;
+};
 
-    return rule;
+inline int ratingSlot(char key)
+{
+    return key == 'x' ? 0 : key == 'm' ? 1 : key == 'a' ? 2 : 3;
 }
 
-std::pair<std::string, std::vector<rule_t>> parseRules(std::string rule_line)
+DecisionTree compileWorkflows(std::stringstream &file_content)
 {
-    std::string name;
-    std::vector<rule_t> rules;
-    std::string rule;
-    bool in_name = true;
-    bool in_rule = false;
-    for (auto c : rule_line)
+    struct pending_rule_t
     {
-        if (in_name)
-        {
-            if (c == '{')
-            {
-                in_name = false;
-                in_rule = true;
-            }
-            else
-            {
-                name += c;
-            }
-        }
-        else if (in_rule)
+        int slot;
+        char op;
+        int value;
+        std::string next;
+    };
+
+    std::vector<std::string> names;
+    std::vector<std::vector<pending_rule_t>> workflows;
+
+    for (std::string line; std::getline(file_content, line) && !line.empty();)
+    {
+        size_t open = line.find('{');
+        names.push_back(line.substr(0, open));
+        workflows.emplace_back();
+
+        size_t begin = open + 1;
+        while (begin < line.size())
         {
-            if (c == ',')
-            {
-                rules.push_back(parseRule(rule));
-                rule = "";
-            }
-            else if (c == '}')
-            {
-                rules.push_back(parseRule(rule));
-                rule = "";
-                in_rule = false;
-            }
+            size_t end = line.find_first_of(",}", begin);
+            std::string rule = line.substr(begin, end - begin);
+            size_t colon = rule.find(':');
+            if (colon == std::string::npos)
+                workflows.back().push_back({0, 0, 0, rule});
             else
-            {
-                rule += c;
-            }
+                workflows.back().push_back({ratingSlot(rule[0]), rule[1], std::stoi(rule.substr(2, colon - 2)), rule.substr(colon + 1)});
+            begin = end + 1;
         }
     }
 
-    return {name, rules};
-}
+    // Node ids of every conditional rule are known up front, so targets can be
+    // resolved in one pass
+    DecisionTree tree;
+    std::vector<int> first_node(workflows.size());
+    int node_count = 0;
+    for (size_t w = 0; w < workflows.size(); ++w)
+    {
+        first_node[w] = node_count;
+        for (const auto &rule : workflows[w])
+            node_count += rule.op != 0;
+    }
 
-std::unordered_map<std::string, std::vector<rule_t>> parseInput(std::stringstream &file_content)
-{
-    std::unordered_map<std::string, std::vector<rule_t>> rules_list;
-    std::string line;
-    while (std::getline(file_content, line))
+    // A workflow made of a lone default rule has no node, it is encoded as -3 - w
+    std::unordered_map<std::string, int> entries = {{"A", ACCEPT}, {"R", REJECT}};
+    for (size_t w = 0; w < workflows.size(); ++w)
+        entries[names[w]] = workflows[w].front().op ? first_node[w] : -3 - (int)w;
+
+    auto resolve = [&](const std::string &name)
+    {
+        auto it = entries.find(name);
+        return it == entries.end() ? REJECT : it->second;
+    };
+
+    // Such aliases are followed until a node or a leaf
+    auto target = [&](const std::string &name)
+    {
+        int id = resolve(name);
+        for (size_t hops = 0; id <= -3 && hops <= workflows.size(); ++hops)
+            id = resolve(workflows[-3 - id].back().next);
+        return id <= -3 ? REJECT : id;
+    };
+
+    tree.nodes.resize(node_count);
+    for (size_t w = 0; w < workflows.size(); ++w)
     {
-        if (line.empty())
-            return rules_list;
-        auto [name, rules] = parseRules(line);
-        rules_list[name] = rules;
+        int node = first_node[w];
+        const auto &rules = workflows[w];
+        for (size_t r = 0; r + 1 < rules.size(); ++r, ++node)
+        {
+            const auto &rule = rules[r];
+            int matched = target(rule.next);
+            int otherwise = rules[r + 1].op ? node + 1 : target(rules[r + 1].next);
+            if (rule.op == '<')
+                tree.nodes[node] = {rule.slot, rule.value, {matched, otherwise}};
+            else
+                tree.nodes[node] = {rule.slot, rule.value + 1, {otherwise, matched}};
+        }
     }
 
-    return rules_list;
+    tree.root = target("in");
+    return tree;
 }
 
-std::vector<std::unordered_map<char, int>> parseParts(std::stringstream &file_content)
+std::vector<part_t> parseParts(std::stringstream &file_content)
 {
-    std::vector<std::unordered_map<char, int>> parts;
-    std::string line;
-    while (std::getline(file_content, line))
+    std::vector<part_t> parts;
+    for (std::string line; std::getline(file_content, line) && !line.empty();)
     {
-        if (line.empty())
-            return parts;
-        std::unordered_map<char, int> part;
-        size_t tok = line.find('=');
-        while (tok != line.npos)
+        part_t part = {0, 0, 0, 0};
+        for (size_t tok = line.find('='); tok != line.npos; tok = line.find('=', tok + 1))
         {
-            char key = line[tok - 1];
-            int value = std::stoi(line.substr(tok + 1));
-            part[key] = value;
-            tok = line.find('=', tok + 1);
+            int value = 0;
+            for (size_t i = tok + 1; i < line.size() && std::isdigit(line[i]); ++i)
+                value = value * 10 + (line[i] - '0');
+            part[ratingSlot(line[tok - 1])] = value;
         }
         parts.push_back(part);
     }
-
     return parts;
 }
 
-bool isPartAccepted(std::unordered_map<char, int> &part, std::unordered_map<std::string, std::vector<rule_t>> &rules_list)
+inline bool isPartAccepted(const DecisionTree &tree, const part_t &part)
 {
-    std::string current_key = "in";
-
-    while (true)
+    int node = tree.root;
+    while (node >= 0)
     {
-        std::vector<rule_t> rules = rules_list[current_key];
-        for (auto rule : rules)
-        {
-            if (rule.op == 0)
-            {
-                current_key = rule.next;
-                break;
-            }
-            if (rule.op == '<' && part[rule.key] < rule.value)
-            {
-                current_key = rule.next;
-                break;
-            }
-            if (rule.op == '>' && part[rule.key] > rule.value)
-            {
-                current_key = rule.next;
-                break;
-            }
-        }
-
-        if (current_key == "A")
-            return true;
-        if (current_key == "R")
-            return false;
+        const decision_node_t &decision = tree.nodes[node];
+        node = decision.next[part[decision.slot] >= decision.threshold];
     }
-
-    return true;
+    return node == ACCEPT;
 }
 
-std::string part1(std::stringstream &file_content)
+// Classifies a batch of parts, accepted[i] is set for every accepted part
+void classifyParts(const DecisionTree &tree, const std::vector<part_t> &parts, std::vector<bool> &accepted)
 {
+    accepted.resize(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i)
+        accepted[i] = isPartAccepted(tree, parts[i]);
+}
 
-    auto rules_list = parseInput(file_content);
-    auto parts = parseParts(file_content);
-
-    std::vector<std::unordered_map<char, int>> accepted_parts;
-    std::copy_if(parts.begin(), parts.end(), std::back_inserter(accepted_parts), [&](std::unordered_map<char, int> &part)
-                 { return isPartAccepted(part, rules_list); });
-
-    int sum_values = 0;
-    for (auto part : accepted_parts)
+// Splits the box along the tree, collecting every accepted sub-box (half-open bounds)
+void partitionAccepted(DecisionTree &tree, int node, box_t box)
+{
+    if (node == REJECT || box.volume() == 0)
+        return;
+    if (node == ACCEPT)
     {
-        for (auto _part : part)
-            sum_values += _part.second;
+        tree.accepted_boxes.push_back(box);
+        return;
     }
 
-    return std::to_string(sum_values);
+    const decision_node_t &decision = tree.nodes[node];
+    box_t below = box, above = box;
+    below.high[decision.slot] = std::min(box.high[decision.slot], decision.threshold);
+    above.low[decision.slot] = std::max(box.low[decision.slot], decision.threshold);
+    partitionAccepted(tree, decision.next[0], below);
+    partitionAccepted(tree, decision.next[1], above);
 }
 
-unsigned long long getTotalAccepted(std::unordered_map<std::string, std::vector<rule_t>> &rules_list, std::array<int, 8> min_max, std::string current_key)
+// Number of accepted rating combinations inside the query box
+unsigned long long countAccepted(const DecisionTree &tree, const box_t &query)
 {
-
     unsigned long long total = 0;
-    if (current_key == "A")
-        return (unsigned long long)(min_max[1] - min_max[0] + 1) * (unsigned long long)(min_max[3] - min_max[2] + 1) * (unsigned long long)(min_max[5] - min_max[4] + 1) * (unsigned long long)(min_max[7] - min_max[6] + 1);
-    if (current_key == "R")
-        return 0;
-
-    std::vector<rule_t> rules = rules_list[current_key];
-    for (const auto &rule : rules)
+    for (const box_t &box : tree.accepted_boxes)
     {
-        if (rule.op == 0)
-            total += getTotalAccepted(rules_list, min_max, rule.next);
-
-        if (rule.op == '<')
-        {
-            int index = std::string("xmas").find(rule.key);
-
-            int n = std::min(min_max[index * 2 + 1], rule.value - 1);
-            if (n >= min_max[index * 2])
-            {
-                int prev = min_max[index * 2 + 1];
-                min_max[index * 2 + 1] = n;
-                total += getTotalAccepted(rules_list, min_max, rule.next);
-                min_max[index * 2 + 1] = prev;
-            }
-            min_max[index * 2] = std::max(min_max[index * 2], rule.value);
-        }
-        if (rule.op == '>')
+        box_t overlap;
+        for (int slot = 0; slot < 4; ++slot)
         {
-            int index = std::string("xmas").find(rule.key);
-
-            int n = std::max(min_max[index * 2], rule.value + 1);
-            if (n <= min_max[index * 2 + 1])
-            {
-                int prev = min_max[index * 2];
-                min_max[index * 2] = n;
-                total += getTotalAccepted(rules_list, min_max, rule.next);
-                min_max[index * 2] = prev;
-            }
-            min_max[index * 2 + 1] = std::min(min_max[index * 2 + 1], rule.value);
+            overlap.low[slot] = std::max(box.low[slot], query.low[slot]);
+            overlap.high[slot] = std::min(box.high[slot], query.high[slot]);
         }
+        total += overlap.volume();
     }
-
     return total;
 }
 
+std::string part1(std::stringstream &file_content)
+{
+    DecisionTree tree = compileWorkflows(file_content);
+    auto parts = parseParts(file_content);
+
+    std::vector<bool> accepted;
+    classifyParts(tree, parts, accepted);
+
+    long long sum_values = 0;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        if (accepted[i])
+            sum_values += std::accumulate(parts[i].begin(), parts[i].end(), 0LL);
+    }
+
+    return std::to_string(sum_values);
+}
+
 std::string part2(std::stringstream &file_content)
 {
-    auto rules_list = parseInput(file_content);
-    return std::to_string(getTotalAccepted(rules_list, {1, 4000, 1, 4000, 1, 4000, 1, 4000}, "in"));
-}
\ No newline at end of file
+    DecisionTree tree = compileWorkflows(file_content);
+    box_t full_range = {{MIN_RATING, MIN_RATING, MIN_RATING, MIN_RATING}, {MAX_RATING + 1, MAX_RATING + 1, MAX_RATING + 1, MAX_RATING + 1}};
+    partitionAccepted(tree, tree.root, full_range);
+
+    return std::to_string(countAccepted(tree, full_range));
+}
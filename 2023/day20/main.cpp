@@ -9,7 +9,9 @@
 #include <memory>
 #include <numeric>
 #include <unordered_map>
-#include <queue>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -105,221 +107,385 @@ enum class ModuleType
     Conjuctor = 2,
 };
 
-struct ModuleConfiguration
+/*
+ * Modules are interned to dense ids and their outputs stored as one edge
+ * array (CSR). A conjunction remembers the last pulse of every incoming
+ * edge and counts how many of them are high, so it fires low when that count
+ * reaches its number of inputs, however many there are. Pulses go through a
+ * ring buffer reused across button presses.
+ */
+
+struct edge_t
+{
+    uint32_t to;
+};
+
+struct Network
+{
+    std::vector<std::string> names;
+    std::vector<ModuleType> types;
+    std::vector<uint32_t> edge_begin;
+    std::vector<edge_t> edges;
+    std::vector<uint32_t> input_count;
+    int broadcaster = -1;
+
+    int find(const std::string &name) const
+    {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : it - names.begin();
+    }
+};
+
+struct pulse_t
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t edge; // index in Network::edges, UINT32_MAX for the button
+    bool high;
+};
+
+class PulseRing
+{
+public:
+    explicit PulseRing(size_t capacity = 64)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        buffer.resize(size);
+    }
+
+    bool empty() const { return head == tail; }
+
+    void push(const pulse_t &pulse)
+    {
+        if (tail - head == buffer.size())
+            grow();
+        buffer[tail++ & (buffer.size() - 1)] = pulse;
+    }
+
+    pulse_t pop() { return buffer[head++ & (buffer.size() - 1)]; }
+
+private:
+    std::vector<pulse_t> buffer;
+    size_t head = 0;
+    size_t tail = 0;
+
+    void grow()
+    {
+        std::vector<pulse_t> larger(buffer.size() * 2);
+        for (size_t i = head; i < tail; ++i)
+            larger[i - head] = buffer[i & (buffer.size() - 1)];
+        tail -= head;
+        head = 0;
+        buffer.swap(larger);
+    }
+};
+
+struct NetworkState
 {
-    ModuleType type;
-    std::string module_name;
-    bool state;
-    std::vector<std::string> outputs;
-    std::unordered_map<std::string, bool> input_pulse_values;
+    std::vector<uint8_t> flip_flops;
+    std::vector<uint8_t> edge_high;
+    std::vector<uint32_t> high_inputs;
+    std::vector<uint64_t> low_received;
+    std::vector<uint64_t> high_received;
+    PulseRing pulses;
+
+    explicit NetworkState(const Network &network)
+        : flip_flops(network.names.size(), 0), edge_high(network.edges.size(), 0),
+          high_inputs(network.names.size(), 0),
+          low_received(network.names.size(), 0), high_received(network.names.size(), 0),
+          pulses(network.edges.size() + 1) {}
 };
 
-std::unordered_map<std::string, ModuleConfiguration> parseConfigurations(std::stringstream &file_content)
+Network parseConfigurations(std::stringstream &file_content)
 {
-    std::unordered_map<std::string, ModuleConfiguration> configuration;
-    std::string line;
-    while (std::getline(file_content, line))
+    Network network;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::vector<uint32_t>> outputs;
+
+    auto intern = [&](const std::string &name)
     {
-        if (line.empty())
+        auto [it, inserted] = ids.emplace(name, network.names.size());
+        if (inserted)
         {
-            break;
+            network.names.push_back(name);
+            network.types.push_back(ModuleType::None);
+            outputs.emplace_back();
         }
+        return it->second;
+    };
 
+    for (std::string line; std::getline(file_content, line) && !line.empty();)
+    {
         std::stringstream line_stream(line);
-        std::string input;
-        std::string arrow;
-        std::string output;
+        std::string input, arrow;
         line_stream >> input >> arrow;
 
-        ModuleConfiguration module_configuration;
-        module_configuration.state = false;
-        if (input[0] == TYPE_FLIPFLIP_TOKEN)
+        ModuleType type = ModuleType::None;
+        if (input[0] == TYPE_FLIPFLIP_TOKEN || input[0] == TYPE_CONJUCTOR_TOKEN)
         {
-            module_configuration.module_name = input.substr(1);
-            module_configuration.type = ModuleType::FlipFlop;
+            type = input[0] == TYPE_FLIPFLIP_TOKEN ? ModuleType::FlipFlop : ModuleType::Conjuctor;
+            input = input.substr(1);
         }
-        else if (input[0] == TYPE_CONJUCTOR_TOKEN)
-        {
-            module_configuration.module_name = input.substr(1);
-            module_configuration.type = ModuleType::Conjuctor;
-        }
-        else
+
+        uint32_t id = intern(input);
+        network.types[id] = type;
+        for (std::string output; line_stream >> output;)
         {
-            module_configuration.module_name = input;
-            module_configuration.type = ModuleType::None;
+            if (output.back() == ',')
+                output.pop_back();
+            uint32_t output_id = intern(output);
+            outputs[id].push_back(output_id);
         }
+    }
 
-        for (std::string output; std::getline(line_stream, output, ',');)
+    size_t module_count = network.names.size();
+    network.input_count.assign(module_count, 0);
+    network.edge_begin.push_back(0);
+    for (size_t id = 0; id < module_count; ++id)
+    {
+        for (uint32_t to : outputs[id])
         {
-
-            output.erase(output.begin(), std::find_if(output.begin(), output.end(), [](int ch)
-                                                      { return !std::isspace(ch); }));
-            module_configuration.outputs.push_back(output);
+            network.input_count[to]++;
+            network.edges.push_back({to});
         }
-        if (module_configuration.type == ModuleType::None)
-            configuration[input] = module_configuration;
-        else
-            configuration[input.substr(1)] = module_configuration;
+        network.edge_begin.push_back(network.edges.size());
     }
 
-    return configuration;
+    network.broadcaster = network.find("broadcaster");
+    return network;
 }
 
-struct pulse_t
-{
-    std::string from;
-    bool value;
-    std::string to;
-};
-
-std::string part1(std::stringstream &file_content)
+/*
+ * Presses the button once. Pulses towards modules outside members (when
+ * given) are dropped, which runs a subgraph on its own. observe(pulse) is
+ * called for every delivered pulse.
+ */
+template <typename Observer>
+void pressButton(const Network &network, NetworkState &state, const std::vector<bool> *members, Observer observe)
 {
+    if (network.broadcaster < 0)
+        return;
 
-    auto configurations = parseConfigurations(file_content);
-
-    for (auto &pair : configurations)
+    auto send = [&](uint32_t from, bool high)
     {
-        auto &module_configuration = pair.second;
-        for (auto &output : module_configuration.outputs)
-            if (configurations[output].type == ModuleType::Conjuctor)
-                configurations[output].input_pulse_values[module_configuration.module_name] = false;
-    }
-
-    std::queue<pulse_t> pulses;
-    int high_pulses_count = 0;
-    int low_pulses_count = 0;
+        for (uint32_t e = network.edge_begin[from]; e < network.edge_begin[from + 1]; ++e)
+        {
+            const edge_t &edge = network.edges[e];
+            if (!members || (*members)[edge.to])
+                state.pulses.push({from, edge.to, e, high});
+            else
+                observe(pulse_t{from, edge.to, e, high});
+        }
+    };
 
-    for (int i = 1000; i--;)
+    state.pulses.push({UINT32_MAX, (uint32_t)network.broadcaster, UINT32_MAX, false});
+    while (!state.pulses.empty())
     {
-        pulses.push({"button", false, "broadcaster"});
-        while (!pulses.empty())
-        {
+        pulse_t pulse = state.pulses.pop();
+        observe(pulse);
+        (pulse.high ? state.high_received : state.low_received)[pulse.to]++;
 
-            auto pulse = pulses.front();
-            pulses.pop();
-            if (pulse.value)
-                high_pulses_count++;
-            else
-                low_pulses_count++;
-            auto &module_configuration = configurations[pulse.to];
-            if (module_configuration.type == ModuleType::FlipFlop)
-            {
-                if (pulse.value == false)
-                {
-                    module_configuration.state = !module_configuration.state;
-                    for (auto &output : module_configuration.outputs)
-                        pulses.push({pulse.to, module_configuration.state, output});
-                }
-            }
-            else if (module_configuration.type == ModuleType::Conjuctor)
+        switch (network.types[pulse.to])
+        {
+        case ModuleType::FlipFlop:
+            if (!pulse.high)
             {
-                module_configuration.input_pulse_values[pulse.from] = pulse.value;
-                bool value = std::accumulate(module_configuration.input_pulse_values.begin(), module_configuration.input_pulse_values.end(), true, [](bool acc, std::pair<std::string, bool> pair)
-                                             { return acc && pair.second; });
-                for (auto &output : module_configuration.outputs)
-                    pulses.push({pulse.to, !value, output});
+                state.flip_flops[pulse.to] ^= 1;
+                send(pulse.to, state.flip_flops[pulse.to]);
             }
-            else
+            break;
+        case ModuleType::Conjuctor:
+        {
+            if (pulse.edge != UINT32_MAX && state.edge_high[pulse.edge] != pulse.high)
             {
-                for (auto &output : module_configuration.outputs)
-                    pulses.push({pulse.to, pulse.value, output});
+                state.edge_high[pulse.edge] = pulse.high;
+                state.high_inputs[pulse.to] += pulse.high ? 1 : -1;
             }
+            send(pulse.to, state.high_inputs[pulse.to] != network.input_count[pulse.to]);
+            break;
+        }
+        default:
+            send(pulse.to, pulse.high);
+            break;
         }
     }
+}
 
-    return std::to_string(high_pulses_count * low_pulses_count);
+// Batch mode: presses the button n times, the per-module counters are left in state
+void pressButton(const Network &network, NetworkState &state, long long presses)
+{
+    for (long long i = 0; i < presses; ++i)
+        pressButton(network, state, nullptr, [](const pulse_t &) {});
 }
 
-std::string part2(std::stringstream &file_content)
+std::string part1(std::stringstream &file_content)
 {
+    Network network = parseConfigurations(file_content);
+    NetworkState state(network);
+    pressButton(network, state, 1000);
 
-    auto configurations = parseConfigurations(file_content);
-    for (auto &pair : configurations)
-    {
-        auto &module_configuration = pair.second;
-        for (auto &output : module_configuration.outputs)
-            if (configurations[output].type == ModuleType::Conjuctor)
-                configurations[output].input_pulse_values[module_configuration.module_name] = false;
-    }
+    uint64_t low = std::accumulate(state.low_received.begin(), state.low_received.end(), uint64_t(0));
+    uint64_t high = std::accumulate(state.high_received.begin(), state.high_received.end(), uint64_t(0));
+    return std::to_string(low * high);
+}
+
+/*
+ * rx is fed by one conjunction, itself fed by independent counter subgraphs.
+ * Each subgraph is the set of modules reaching one input of the feeder; it
+ * is simulated alone, on its own thread, until it has sent two high pulses
+ * to the feeder, which gives its first firing and its period.
+ */
+struct counter_cycle_t
+{
+    long long first = 0;
+    long long period = 0;
+};
 
-    std::string rx_conjuctor;
-    for (auto &pair : configurations)
+counter_cycle_t findCounterCycle(const Network &network, uint32_t source, uint32_t feeder)
+{
+    std::vector<std::vector<uint32_t>> reverse_edges(network.names.size());
+    for (size_t from = 0; from < network.names.size(); ++from)
+        for (uint32_t e = network.edge_begin[from]; e < network.edge_begin[from + 1]; ++e)
+            reverse_edges[network.edges[e].to].push_back(from);
+
+    std::vector<bool> members(network.names.size(), false);
+    std::vector<uint32_t> stack = {source};
+    members[source] = true;
+    while (!stack.empty())
     {
-        auto &module_configuration = pair.second;
-        if (module_configuration.type == ModuleType::Conjuctor)
+        uint32_t id = stack.back();
+        stack.pop_back();
+        for (uint32_t from : reverse_edges[id])
         {
-            for (auto &output : module_configuration.outputs)
-                if (output == "rx")
-                {
-                    rx_conjuctor = module_configuration.module_name;
-                    break;
-                }
+            if (!members[from] && from != feeder)
+            {
+                members[from] = true;
+                stack.push_back(from);
+            }
         }
-        if (!rx_conjuctor.empty())
-            break;
     }
 
-    std::queue<pulse_t> pulses;
-    std::unordered_map<std::string, std::vector<int>> rx_conjuctor_high_pulse_indexes;
+    constexpr long long MAX_PRESSES = 1LL << 24;
+    NetworkState state(network);
+    std::vector<long long> fired;
+    for (long long press = 1; press <= MAX_PRESSES && fired.size() < 2; ++press)
+    {
+        bool fires = false;
+        pressButton(network, state, &members, [&](const pulse_t &pulse)
+                    { fires |= pulse.from == source && pulse.to == feeder && pulse.high; });
+        if (fires)
+            fired.push_back(press);
+    }
+
+    if (fired.size() < 2)
+        return {0, 0};
+    return {fired[0], fired[1] - fired[0]};
+}
+
+// Press counts can outgrow 64 bits once the counter periods are merged
+using press_t = __int128;
 
-    for (int i = 0;; ++i)
+press_t extendedGcd(press_t a, press_t b, press_t &x, press_t &y)
+{
+    if (b == 0)
     {
+        x = 1;
+        y = 0;
+        return a;
+    }
+    press_t x1, y1;
+    press_t g = extendedGcd(b, a % b, x1, y1);
+    x = y1;
+    y = x1 - (a / b) * y1;
+    return g;
+}
 
-        std::unordered_map<std::string, bool> has_high_pulse;
-        pulses.push({"button", false, "broadcaster"});
-        while (!pulses.empty())
-        {
+// Merges p = r1 mod m1 and p = r2 mod m2 into one congruence, moduli need not be coprime
+std::optional<std::pair<press_t, press_t>> combineCongruences(std::pair<press_t, press_t> a, std::pair<press_t, press_t> b)
+{
+    auto [r1, m1] = a;
+    auto [r2, m2] = b;
+    press_t p, q;
+    press_t g = extendedGcd(m1, m2, p, q);
+    if ((r2 - r1) % g != 0)
+        return std::nullopt;
 
-            auto pulse = pulses.front();
-            pulses.pop();
+    press_t m2g = m2 / g;
+    press_t k = ((r2 - r1) / g % m2g * (p % m2g)) % m2g;
+    if (k < 0)
+        k += m2g;
+    press_t lcm = m1 * m2g;
+    return std::make_pair((r1 + k * m1) % lcm, lcm);
+}
 
-            if (pulse.to == rx_conjuctor && pulse.value == true)
-                has_high_pulse[pulse.from] = true;
+std::string pressesToString(press_t presses)
+{
+    std::string result;
+    do
+    {
+        result.insert(result.begin(), char('0' + (int)(presses % 10)));
+        presses /= 10;
+    } while (presses > 0);
+    return result;
+}
 
-            auto &module_configuration = configurations[pulse.to];
-            if (module_configuration.type == ModuleType::FlipFlop)
-            {
-                if (pulse.value == false)
-                {
-                    module_configuration.state = !module_configuration.state;
-                    for (auto &output : module_configuration.outputs)
-                        pulses.push({pulse.to, module_configuration.state, output});
-                }
-            }
-            else if (module_configuration.type == ModuleType::Conjuctor)
-            {
-                module_configuration.input_pulse_values[pulse.from] = pulse.value;
-                bool value = std::accumulate(module_configuration.input_pulse_values.begin(), module_configuration.input_pulse_values.end(), true, [](bool acc, std::pair<std::string, bool> pair)
-                                             { return acc && pair.second; });
-                for (auto &output : module_configuration.outputs)
-                    pulses.push({pulse.to, !value, output});
-            }
-            else
-            {
-                for (auto &output : module_configuration.outputs)
-                    pulses.push({pulse.to, pulse.value, output});
-            }
+std::string part2(std::stringstream &file_content)
+{
+    Network network = parseConfigurations(file_content);
+    int rx = network.find("rx");
+    if (rx < 0)
+        return "0";
+
+    int feeder = -1;
+    std::vector<uint32_t> sources;
+    for (size_t from = 0; from < network.names.size(); ++from)
+    {
+        for (uint32_t e = network.edge_begin[from]; e < network.edge_begin[from + 1]; ++e)
+        {
+            if ((int)network.edges[e].to == rx)
+                feeder = from;
         }
-
-        for (auto ins : configurations[rx_conjuctor].input_pulse_values)
+    }
+    if (feeder < 0 || network.types[feeder] != ModuleType::Conjuctor)
+        return "0";
+    for (size_t from = 0; from < network.names.size(); ++from)
+    {
+        for (uint32_t e = network.edge_begin[from]; e < network.edge_begin[from + 1]; ++e)
         {
-            if (has_high_pulse[ins.first] != 0)
-            {
-                rx_conjuctor_high_pulse_indexes[ins.first].push_back(i);
-            }
-        };
-
-        bool stop = std::all_of(configurations[rx_conjuctor].input_pulse_values.begin(), configurations[rx_conjuctor].input_pulse_values.end(), [&rx_conjuctor_high_pulse_indexes](std::pair<std::string, bool> pair)
-                                { return rx_conjuctor_high_pulse_indexes[pair.first].size() >= 2; });
-        if (stop)
-            break;
+            if ((int)network.edges[e].to == feeder)
+                sources.push_back(from);
+        }
     }
 
-    unsigned long long int lcm = 1;
-    for (auto ins : configurations[rx_conjuctor].input_pulse_values)
+    std::vector<counter_cycle_t> cycles(sources.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sources.size(); ++i)
+        threads.emplace_back([&, i]
+                             { cycles[i] = findCounterCycle(network, sources[i], feeder); });
+    for (auto &thread : threads)
+        thread.join();
+
+    // Presses p with p = first (mod period) for every counter, merged with the CRT
+    std::pair<press_t, press_t> congruence = {0, 1};
+    press_t earliest = 0;
+    for (const auto &cycle : cycles)
     {
-        lcm = std::lcm(lcm, (unsigned long long int)(rx_conjuctor_high_pulse_indexes[ins.first][1] - rx_conjuctor_high_pulse_indexes[ins.first][0]));
-    };
+        if (cycle.period == 0)
+            return "0";
+        earliest = std::max<press_t>(earliest, cycle.first);
+        auto combined = combineCongruences(congruence, {cycle.first % cycle.period, cycle.period});
+        if (!combined)
+            return "0";
+        congruence = *combined;
+    }
+
+    auto [residue, modulus] = congruence;
+    if (residue < earliest)
+        residue += (earliest - residue + modulus - 1) / modulus * modulus;
+    if (residue == 0)
+        residue = modulus;
 
-    return std::to_string(lcm);
+    return pressesToString(residue);
 }
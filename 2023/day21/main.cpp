@@ -9,8 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <algorithm>
-#include <queue>
-#include <unordered_set>
+#include <array>
+#include <cstdint>
 /*************
  * Setup code
  **************/
@@ -96,181 +96,292 @@ int main(int argc, char const *argv[])
  **************************************/
 const std::array<std::array<int, 2>, 4> directions = {{{0, -1}, {0, 1}, {-1, 0}, {1, 0}}};
 
-std::vector<std::string> parseInput(std::stringstream &file_content)
+// Step counts of the puzzle, unless the input starts with "steps: <part 1> <part 2>"
+constexpr std::array<long long, 2> DEFAULT_STEPS = {64, 26501365};
+
+// Tiles on each side of the start tile simulated before extrapolating
+constexpr int TILED_BFS_RADIUS = 4;
+
+using count_t = __int128;
+
+struct Garden
 {
-    std::vector<std::string> input;
-    std::string line;
-    while (std::getline(file_content, line))
+    int width = 0;
+    int height = 0;
+    std::array<int, 2> start = {0, 0};
+    std::array<long long, 2> steps = DEFAULT_STEPS;
+    std::vector<std::string> map;
+};
+
+/*
+ * Reachability from one source inside a single tile. A plot is reachable in
+ * exactly r steps iff its distance is <= r with the same parity, so a BFS on
+ * a dense distance grid reduces to per-parity prefix counts by distance.
+ */
+struct TileReach
+{
+    int max_distance = 0;
+    std::vector<count_t> within;
+
+    count_t reachable(long long steps) const
     {
-        std::string newline;
-        for (int i = 0; i < 1; ++i)
-            newline += line;
-        input.push_back(newline);
+        if (steps < 0)
+            return 0;
+        if (steps >= max_distance)
+            return within[max_distance - 1 + ((steps - max_distance + 1) % 2)];
+        return within[steps];
     }
+};
 
-    std::vector<std::string> new_input;
-    for (int i = 0; i < 1; ++i)
-        new_input.insert(new_input.end(), input.begin(), input.end());
+Garden parseInput(std::stringstream &file_content)
+{
+    Garden garden;
+    for (std::string line; std::getline(file_content, line);)
+    {
+        if (line.empty())
+            continue;
+        if (line.rfind("steps:", 0) == 0)
+        {
+            std::istringstream(line.substr(6)) >> garden.steps[0] >> garden.steps[1];
+            continue;
+        }
+        size_t col = line.find('S');
+        if (col != std::string::npos)
+        {
+            garden.start = {(int)garden.map.size(), (int)col};
+            line[col] = '.';
+        }
+        garden.map.push_back(line);
+    }
 
-    return new_input;
+    garden.height = garden.map.size();
+    garden.width = garden.map[0].size();
+    return garden;
 }
 
-#define PART1_KEEP_STEP 64
-
-std::string part1(std::stringstream &file_content)
+TileReach reachFrom(const Garden &garden, int row, int col)
 {
+    std::vector<int> distance((size_t)garden.width * garden.height, -1);
+    std::vector<int> frontier = {row * garden.width + col}, next_frontier;
+    distance[frontier[0]] = 0;
 
-    auto input_map = parseInput(file_content);
-
-    std::array<int, 2> position = {0, 0};
-    bool position_found = false;
-
-    for (size_t i = 0; i < input_map.size() && !position_found; i++)
+    // within[d]: plots at distance <= d with the parity of d
+    std::vector<count_t> at_distance;
+    for (int d = 0; !frontier.empty(); ++d)
     {
-        for (size_t j = 0; j < input_map[i].size(); j++)
+        at_distance.push_back(frontier.size());
+        next_frontier.clear();
+        for (int cell : frontier)
         {
-            if (input_map[i][j] == 'S')
+            int r = cell / garden.width, c = cell % garden.width;
+            for (const auto &direction : directions)
             {
-                position[0] = i;
-                position[1] = j;
-                input_map[i][j] = '.';
-                position_found = true;
-                break;
+                int nr = r + direction[0], nc = c + direction[1];
+                if (nr < 0 || nr >= garden.height || nc < 0 || nc >= garden.width || garden.map[nr][nc] != '.')
+                    continue;
+                int next = nr * garden.width + nc;
+                if (distance[next] >= 0)
+                    continue;
+                distance[next] = d + 1;
+                next_frontier.push_back(next);
             }
         }
+        frontier.swap(next_frontier);
     }
 
-    std::queue<std::pair<std::array<int, 2>, int>> queue;
-    auto hash = [](const std::pair<std::array<int, 2>, int> &p)
-    { return std::hash<int>()(p.first[0]) ^ std::hash<int>()(p.first[1]); };
-    auto cmp = [](const std::pair<std::array<int, 2>, int> &p1, const std::pair<std::array<int, 2>, int> &p2)
-    { return p1.first == p2.first; };
-    std::unordered_set<std::pair<std::array<int, 2>, int>, decltype(hash), decltype(cmp)> visited(100000, hash, cmp);
+    TileReach reach;
+    reach.max_distance = at_distance.size();
+    reach.within.resize(reach.max_distance + 1, 0);
+    for (int d = 0; d < reach.max_distance; ++d)
+        reach.within[d] = at_distance[d] + (d >= 2 ? reach.within[d - 2] : 0);
+    reach.within[reach.max_distance] = reach.max_distance >= 2 ? reach.within[reach.max_distance - 2] : 0;
+    return reach;
+}
 
-    queue.push({position, 0});
-    visited.insert({position, 0});
+/*
+ * Sum over k >= 0 of weight(k) * reach.reachable(first - k * period), with
+ * weight(k) = k + 1 when linear_weight is set, else 1. Terms past the tile
+ * eccentricity are full tiles whose count only depends on parity, so they are
+ * summed in closed form and only the last few tiles are evaluated one by one.
+ */
+count_t sumTiles(const TileReach &reach, long long first, long long period, bool linear_weight)
+{
+    if (first < 0)
+        return 0;
 
-    while (!queue.empty())
-    {
-        auto current = queue.front();
-        queue.pop();
+    long long last = first / period;
+    long long last_full = first >= reach.max_distance ? (first - reach.max_distance) / period : -1;
+    count_t total = 0;
 
-        for (auto &direction : directions)
-        {
-            std::array<int, 2> new_position = {current.first[0] + direction[0], current.first[1] + direction[1]};
-
-            if (new_position[0] < 0 || new_position[0] >= (int)input_map.size() || new_position[1] < 0 || new_position[1] >= (int)input_map[0].size())
-                continue;
-            if (visited.find({new_position, current.second}) != visited.end())
-                continue;
-            if (input_map[new_position[0]][new_position[1]] != '.')
-                continue;
-            if (current.second >= PART1_KEEP_STEP)
-                continue;
-
-            queue.push({new_position, current.second + 1});
-            visited.insert({new_position, current.second + 1});
-        }
+    for (int k_parity = 0; k_parity < 2 && last_full >= 0; ++k_parity)
+    {
+        if (last_full < k_parity)
+            continue;
+        count_t m = (last_full - k_parity) / 2 + 1;
+        count_t weight = linear_weight ? m * (k_parity + 1) + m * (m - 1) : m;
+        total += weight * reach.reachable(first - k_parity * period + 2 * reach.max_distance);
     }
 
-    std::vector<std::pair<std::array<int, 2>, int>> kept_positions;
-    std::copy_if(visited.begin(), visited.end(), std::back_inserter(kept_positions), [](const std::pair<std::array<int, 2>, int> &p)
-                 { return p.second <= PART1_KEEP_STEP && p.second % 2 == (PART1_KEEP_STEP % 2); });
+    for (long long k = last_full + 1; k <= last; ++k)
+        total += (linear_weight ? k + 1 : 1) * reach.reachable(first - k * period);
 
-    return std::to_string(kept_positions.size());
+    return total;
 }
 
-#define PART2_KEEP_STEP 330
-
-std::string part2(std::stringstream &file_content)
+/*
+ * Weighted number of tiles n >= 0 of a series whose distances grow by period
+ * per tile, counting those reached in exactly `remaining` more steps: n *
+ * period <= remaining with the same parity. linear_weight gives tile n a
+ * weight of n + 1 (the n-th diagonal of a quadrant).
+ */
+count_t countSeries(long long remaining, long long period, bool linear_weight)
 {
+    if (remaining < 0)
+        return 0;
+    count_t last = remaining / period;
+    if (period % 2 == 0)
+    {
+        if (remaining % 2 != 0)
+            return 0;
+        return linear_weight ? (last + 1) * (last + 2) / 2 : last + 1;
+    }
 
-    auto input_map = parseInput(file_content);
-
-    int map_width = input_map[0].size();
-    int map_height = input_map.size();
+    int parity = remaining % 2;
+    if (last < parity)
+        return 0;
+    count_t m = (last - parity) / 2 + 1;
+    return linear_weight ? m * (parity + 1) + m * (m - 1) : m;
+}
 
-    std::array<int, 2> position = {0, 0};
-    bool position_found = false;
-    for (size_t i = 0; i < input_map.size() && !position_found; i++)
+/*
+ * Layout-agnostic fallback: BFS from S over a block of tiles. When `steps`
+ * stays inside the block the count is direct. Otherwise the outer ring of
+ * TILED_BFS_RADIUS is assumed periodic, a tile further out being one
+ * tile width (or height) further than its neighbour towards S, and each ring
+ * cell stands for a whole series of tiles: a line for edge tiles, a quadrant
+ * for corner tiles. A padding ring keeps the block border from distorting
+ * the ring distances.
+ */
+count_t countTiledReach(const Garden &garden, long long steps)
+{
+    int min_side = std::min(garden.width, garden.height);
+    bool direct = steps < (long long)TILED_BFS_RADIUS * min_side;
+    int radius = direct ? steps / min_side + 1 : TILED_BFS_RADIUS + 1;
+
+    int block_width = (2 * radius + 1) * garden.width;
+    int block_height = (2 * radius + 1) * garden.height;
+    std::vector<int> distance((size_t)block_width * block_height, -1);
+    std::vector<int> frontier = {(radius * garden.height + garden.start[0]) * block_width + radius * garden.width + garden.start[1]}, next_frontier;
+    distance[frontier[0]] = 0;
+    for (int d = 1; !frontier.empty() && d <= steps; ++d)
     {
-        for (size_t j = 0; j < input_map[i].size(); j++)
+        next_frontier.clear();
+        for (int cell : frontier)
         {
-            if (input_map[i][j] == 'S')
+            int r = cell / block_width, c = cell % block_width;
+            for (const auto &direction : directions)
             {
-                position[0] = i;
-                position[1] = j;
-                input_map[i][j] = '.';
-                position_found = true;
-                break;
+                int nr = r + direction[0], nc = c + direction[1];
+                if (nr < 0 || nr >= block_height || nc < 0 || nc >= block_width || garden.map[nr % garden.height][nc % garden.width] == '#')
+                    continue;
+                int next = nr * block_width + nc;
+                if (distance[next] >= 0)
+                    continue;
+                distance[next] = d;
+                next_frontier.push_back(next);
             }
         }
+        frontier.swap(next_frontier);
     }
 
-    std::queue<std::pair<std::array<int, 2>, int>> queue;
-    auto hash = [](const std::pair<std::array<int, 2>, int> &p)
-    { return std::hash<int>()(p.first[0]) ^ std::hash<int>()(p.first[1]); };
-    auto cmp = [](const std::pair<std::array<int, 2>, int> &p1, const std::pair<std::array<int, 2>, int> &p2)
-    { return p1.first == p2.first; };
-    std::unordered_set<std::pair<std::array<int, 2>, int>, decltype(hash), decltype(cmp)> visited(100000, hash, cmp);
-
-    queue.push({position, 0});
-    visited.insert({position, 0});
-    int kept_positions_cnt = PART2_KEEP_STEP % 2 == 0 ? 1 : 0;
-
-    while (!queue.empty())
-    {
-        auto current = queue.front();
-        queue.pop();
-
-        for (auto &direction : directions)
+    count_t total = 0;
+    for (int r = 0; r < block_height; ++r)
+        for (int c = 0; c < block_width; ++c)
         {
-            std::array<int, 2> new_position = {current.first[0] + direction[0], current.first[1] + direction[1]};
-            std::array<int, 2> modulo_position = {(map_height + new_position[0] % map_height) % map_height, (map_width + new_position[1] % map_width) % map_width};
-            if (visited.find({new_position, current.second}) != visited.end())
-                continue;
-            if (input_map[modulo_position[0]][modulo_position[1]] != '.')
-                continue;
-            if (current.second >= PART2_KEEP_STEP)
+            int d = distance[(size_t)r * block_width + c];
+            if (d < 0 || d > steps)
                 continue;
+            long long remaining = steps - d;
+            int tile_row = std::abs(r / garden.height - radius), tile_col = std::abs(c / garden.width - radius);
 
-            queue.push({new_position, current.second + 1});
-            if ((current.second + 1) % 2 == (PART2_KEEP_STEP % 2))
-                kept_positions_cnt++;
-            visited.insert({new_position, current.second + 1});
+            if (direct || (tile_row < TILED_BFS_RADIUS && tile_col < TILED_BFS_RADIUS))
+                total += remaining % 2 == 0;
+            else if (tile_row > TILED_BFS_RADIUS || tile_col > TILED_BFS_RADIUS)
+                continue;
+            else if (tile_col < TILED_BFS_RADIUS)
+                total += countSeries(remaining, garden.height, false);
+            else if (tile_row < TILED_BFS_RADIUS)
+                total += countSeries(remaining, garden.width, false);
+            else if (garden.width == garden.height)
+                total += countSeries(remaining, garden.width, true);
+            else
+                for (long long down = remaining; down >= 0; down -= garden.height)
+                    total += countSeries(down, garden.width, false);
         }
-    }
+    return total;
+}
 
-    std::vector<int> pos_cnt;
-    for (int i = 0; i <= PART2_KEEP_STEP; ++i)
-    {
-        int cnt = std::count_if(visited.begin(), visited.end(), [i](const std::pair<std::array<int, 2>, int> &p)
-                                { return p.second <= i && p.second % 2 == (i % 2); });
+// Square garden, S in the middle, clear middle row, middle column and border
+bool hasClearLanes(const Garden &garden)
+{
+    int n = garden.width, mid = n / 2;
+    if (garden.height != n || n % 2 == 0 || garden.start[0] != mid || garden.start[1] != mid)
+        return false;
+    for (int i = 0; i < n; ++i)
+        for (int line : {0, mid, n - 1})
+            if (garden.map[line][i] != '.' || garden.map[i][line] != '.')
+                return false;
+    return true;
+}
 
-        pos_cnt.push_back(cnt);
-    }
+/*
+ * Plots reachable in exactly `steps` on the infinitely tiled garden. With the
+ * puzzle's layout (see hasClearLanes) a tile is first entered through the
+ * middle of an edge (straight tiles) or through a corner (diagonal tiles, k + 1
+ * of them on the k-th diagonal). Other layouts, and step counts that stay
+ * within a few tiles, go through the tiled BFS.
+ */
+count_t countInfiniteReach(const Garden &garden, long long steps)
+{
+    if (!hasClearLanes(garden) || steps < (long long)TILED_BFS_RADIUS * garden.width)
+        return countTiledReach(garden, steps);
 
-    std::vector<int> delta_pos_cnt(PART2_KEEP_STEP + 1, 0);
-    for (size_t i = map_width; i < pos_cnt.size(); ++i)
-    {
-        delta_pos_cnt[i] = (pos_cnt[i] - pos_cnt[i - map_width]);
-    }
+    int n = garden.width;
+    int mid = garden.start[0];
+    int last = n - 1;
 
-    std::vector<int> delta_pos_delta_cnt(PART2_KEEP_STEP + 1, 0);
-    for (size_t i = 2 * map_width; i < delta_pos_cnt.size(); ++i)
-    {
-        delta_pos_delta_cnt[i] = (delta_pos_cnt[i] - delta_pos_cnt[i - map_width]);
-    }
+    count_t total = reachFrom(garden, mid, mid).reachable(steps);
+
+    const std::array<std::array<int, 2>, 4> edge_entries = {{{last, mid}, {0, mid}, {mid, 0}, {mid, last}}};
+    for (const auto &entry : edge_entries)
+        total += sumTiles(reachFrom(garden, entry[0], entry[1]), steps - (mid + 1), n, false);
 
-    std::vector<std::vector<unsigned long long>> cycles;
-    for (size_t i = 0; i < pos_cnt.size(); ++i)
+    const std::array<std::array<int, 2>, 4> corner_entries = {{{0, 0}, {0, last}, {last, 0}, {last, last}}};
+    for (const auto &entry : corner_entries)
+        total += sumTiles(reachFrom(garden, entry[0], entry[1]), steps - 2 * (mid + 1), n, true);
+
+    return total;
+}
+
+std::string toString(count_t value)
+{
+    std::string result;
+    do
     {
-        cycles.push_back({(unsigned long long)pos_cnt[i], (unsigned long long)delta_pos_cnt[i], (unsigned long long)delta_pos_delta_cnt[i], (unsigned long long)i});
-    }
+        result.insert(result.begin(), char('0' + (int)(value % 10)));
+        value /= 10;
+    } while (value > 0);
+    return result;
+}
+
+std::string part1(std::stringstream &file_content)
+{
+    Garden garden = parseInput(file_content);
+    return toString(reachFrom(garden, garden.start[0], garden.start[1]).reachable(garden.steps[0]));
+}
 
-    unsigned long long cycle_offset = 2 * map_width + 26501365 % map_width;
-    auto &starting_cycle = cycles[cycle_offset];
-    std::vector<unsigned long long> r = starting_cycle;
-    unsigned long long k = (26501365 - r[3]) / map_width;
-    return std::to_string(r[0] + r[1] * k + r[2] * (k * (k + 1) / 2));
+std::string part2(std::stringstream &file_content)
+{
+    Garden garden = parseInput(file_content);
+    return toString(countInfiniteReach(garden, garden.steps[1]));
 }
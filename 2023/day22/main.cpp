@@ -9,9 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <regex>
-#include <unordered_map>
-#include <unordered_set>
-#include <queue>
+#include <array>
+#include <algorithm>
 
 /*************
  * Setup code
@@ -97,18 +96,9 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-struct cube_location_t
-{
-    int x,y,z;
-};
-
 struct brick_t
 {
-    std::vector<cube_location_t> cubes;
-    int z;
-    int height;
-    std::unordered_set<brick_t *> supported_by;
-    std::unordered_set<brick_t *> supports;
+    std::array<int, 3> low, high;
 };
 
 std::vector<brick_t> parseInput(std::stringstream &file_content)
@@ -117,121 +107,159 @@ std::vector<brick_t> parseInput(std::stringstream &file_content)
     std::vector<brick_t> bricks;
     while (std::getline(file_content, line))
     {
+        if (line.empty())
+            continue;
         std::istringstream iss(line);
-        cube_location_t starting_cube;
-        cube_location_t ending_cube;
-        brick_t brick;
+        std::array<int, 3> start, end;
         char c;
-        iss >> starting_cube.x >> c >> starting_cube.y >> c >> starting_cube.z >> c >> ending_cube.x >> c >> ending_cube.y >> c >> ending_cube.z;
+        iss >> start[0] >> c >> start[1] >> c >> start[2] >> c >> end[0] >> c >> end[1] >> c >> end[2];
 
-        std::array<int, 3> diffs = {std::abs(starting_cube.x - ending_cube.x), std::abs(starting_cube.y - ending_cube.y), std::abs(starting_cube.z - ending_cube.z)};
-        int max_diff = *std::max_element(diffs.begin(), diffs.end());
-        for (int i = 0; i <= max_diff; i++)
+        brick_t brick;
+        for (int axis = 0; axis < 3; ++axis)
         {
-            cube_location_t cube = starting_cube;
-            cube.x = starting_cube.x + (starting_cube.x != ending_cube.x ? i : 0);
-            cube.y = starting_cube.y + (starting_cube.y != ending_cube.y ? i : 0);
-            cube.z = starting_cube.z + (starting_cube.z != ending_cube.z ? i : 0);
-            brick.cubes.push_back(cube);
+            brick.low[axis] = std::min(start[axis], end[axis]);
+            brick.high[axis] = std::max(start[axis], end[axis]);
         }
-
-        brick.z = starting_cube.z;
-        brick.height = ending_cube.z - starting_cube.z + 1;
         bricks.push_back(brick);
     }
     return bricks;
 }
 
-void stackBricks(std::vector<brick_t> &bricks)
+/*
+ * Support DAG of the settled stack. Node 0 is the ground and brick i (in
+ * settling order) is node i + 1, so every supporter has a smaller id than the
+ * brick it holds. Supporters are stored CSR-style.
+ */
+struct SupportGraph
 {
-    std::unordered_map<int, std::pair<int, brick_t *>> max_heights;
-    auto computeCubeKey = [](const cube_location_t &cube)
-    {
-        return cube.x * 1000 + cube.y;
-    };
+    std::vector<int> offsets;
+    std::vector<int> supporters;
+
+    int size() const { return offsets.size() - 1; }
+};
 
+SupportGraph settleBricks(std::vector<brick_t> bricks)
+{
     std::sort(bricks.begin(), bricks.end(), [](const brick_t &a, const brick_t &b)
-              { return a.z < b.z; });
+              { return a.low[2] < b.low[2]; });
 
-    for (auto &upper_brick : bricks)
+    int width = 0, depth = 0;
+    for (const auto &brick : bricks)
     {
-        std::unordered_set<brick_t *> lower_bricks;
-        int next_min_height = 0;
-        for (auto &cube : upper_brick.cubes)
-        {
-            int key = computeCubeKey(cube);
-            if (max_heights.find(key) == max_heights.end())
-                continue;
+        width = std::max(width, brick.high[0] + 1);
+        depth = std::max(depth, brick.high[1] + 1);
+    }
+
+    // Dense height map: top z and node of the highest brick over each column
+    std::vector<int> top_z((size_t)width * depth, 0);
+    std::vector<int> top_node((size_t)width * depth, 0);
 
-            if (max_heights[key].first > next_min_height)
+    SupportGraph graph;
+    graph.offsets = {0, 0};
+    for (size_t i = 0; i < bricks.size(); ++i)
+    {
+        const brick_t &brick = bricks[i];
+        int node = i + 1;
+
+        int rest_z = 0;
+        for (int x = brick.low[0]; x <= brick.high[0]; ++x)
+            for (int y = brick.low[1]; y <= brick.high[1]; ++y)
+                rest_z = std::max(rest_z, top_z[(size_t)x * depth + y]);
+
+        // A straight brick overlaps any other one on a contiguous run of
+        // columns, so duplicates are always adjacent
+        size_t first = graph.supporters.size();
+        for (int x = brick.low[0]; x <= brick.high[0]; ++x)
+            for (int y = brick.low[1]; y <= brick.high[1]; ++y)
             {
-                next_min_height = max_heights[key].first;
-                lower_bricks.clear();
-                lower_bricks.insert(max_heights[key].second);
+                size_t column = (size_t)x * depth + y;
+                if (top_z[column] == rest_z && (graph.supporters.size() == first || graph.supporters.back() != top_node[column]))
+                    graph.supporters.push_back(top_node[column]);
+                top_z[column] = rest_z + brick.high[2] - brick.low[2] + 1;
+                top_node[column] = node;
             }
-            else if (max_heights[key].first == next_min_height)
-                lower_bricks.insert(max_heights[key].second);
-        }
-
-        for (auto &cube : upper_brick.cubes)
-            max_heights[computeCubeKey(cube)] = std::make_pair(next_min_height + upper_brick.height, &upper_brick);
-
-        upper_brick.supported_by = lower_bricks;
-        for (auto &lower_brick : lower_bricks)
-            lower_brick->supports.insert(&upper_brick);
+        graph.offsets.push_back(graph.supporters.size());
     }
+    return graph;
 }
 
-std::string part1(std::stringstream &file_content)
+/*
+ * Dominator tree of the support DAG rooted at the ground: a brick falls when
+ * its immediate dominator is removed, and the immediate dominator is the LCA
+ * of its supporters. Nodes arrive in topological order, so binary lifting can
+ * be filled in as the tree grows.
+ */
+struct DominatorTree
 {
+    std::vector<int> depth;
+    std::vector<std::vector<int>> up;
 
-    auto bricks = parseInput(file_content);
+    explicit DominatorTree(const SupportGraph &graph)
+    {
+        int n = graph.size();
+        int levels = 1;
+        while ((1 << levels) < n)
+            ++levels;
+
+        depth.assign(n, 0);
+        up.assign(levels, std::vector<int>(n, 0));
+        for (int node = 1; node < n; ++node)
+        {
+            int dominator = graph.supporters[graph.offsets[node]];
+            for (int k = graph.offsets[node] + 1; k < graph.offsets[node + 1]; ++k)
+                dominator = lca(dominator, graph.supporters[k]);
+
+            depth[node] = depth[dominator] + 1;
+            up[0][node] = dominator;
+            for (int level = 1; level < levels; ++level)
+                up[level][node] = up[level - 1][up[level - 1][node]];
+        }
+    }
 
-    stackBricks(bricks);
+    int parent(int node) const { return up[0][node]; }
 
-    auto canBeDestroyed = [](const brick_t &lower_brick)
+    int lca(int a, int b) const
     {
-        return std::all_of(lower_brick.supports.begin(), lower_brick.supports.end(), [](const brick_t *upper_brick)
-                           { return upper_brick->supported_by.size() >= 2; });
-    };
-
-    return std::to_string(std::count_if(bricks.begin(), bricks.end(), canBeDestroyed));
-}
+        if (depth[a] < depth[b])
+            std::swap(a, b);
+        for (int level = up.size() - 1; level >= 0; --level)
+            if (depth[a] - (1 << level) >= depth[b])
+                a = up[level][a];
+        if (a == b)
+            return a;
+        for (int level = up.size() - 1; level >= 0; --level)
+            if (up[level][a] != up[level][b])
+            {
+                a = up[level][a];
+                b = up[level][b];
+            }
+        return up[0][a];
+    }
+};
 
-std::string part2(std::stringstream &file_content)
+std::string part1(std::stringstream &file_content)
 {
+    SupportGraph graph = settleBricks(parseInput(file_content));
+    DominatorTree tree(graph);
 
-    auto bricks = parseInput(file_content);
+    // A brick is safe to remove iff it dominates no other brick
+    std::vector<bool> dominates(graph.size(), false);
+    for (int node = 1; node < graph.size(); ++node)
+        dominates[tree.parent(node)] = true;
 
-    stackBricks(bricks);
-
-    int total_destroy = 0;
-    for (const auto &brick : bricks)
-    {
-        std::unordered_map<const brick_t *, bool> destroyed;
-        for (const auto &brick : bricks)
-            destroyed[&brick] = false;
-        destroyed[&brick] = true;
+    return std::to_string(std::count(dominates.begin() + 1, dominates.end(), false));
+}
 
-        std::queue<const brick_t *> to_destroy;
-        to_destroy.push(&brick);
+std::string part2(std::stringstream &file_content)
+{
+    SupportGraph graph = settleBricks(parseInput(file_content));
+    DominatorTree tree(graph);
 
-        while (!to_destroy.empty())
-        {
-            const brick_t *current = to_destroy.front();
-            to_destroy.pop();
-
-            bool is_destroyable = destroyed[current] || std::all_of(current->supported_by.begin(), current->supported_by.end(), [&destroyed](const brick_t *b)
-                                                                    { return destroyed[b]; });
-            if (!is_destroyable)
-                continue;
-
-            total_destroy += !destroyed[current];
-            destroyed[current] = true;
-            for (const auto &support : current->supports)
-                to_destroy.push(support);
-        }
-    }
+    // Summing dominator subtree sizes is summing, per brick, how many bricks
+    // dominate it, i.e. its depth below the ground minus itself
+    long long total_destroy = 0;
+    for (int node = 1; node < graph.size(); ++node)
+        total_destroy += tree.depth[node] - 1;
 
     return std::to_string(total_destroy);
-}
\ No newline at end of file
+}
@@ -11,6 +11,11 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <thread>
 
 /*************
  * Setup code
@@ -96,49 +101,197 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-std::pair<std::vector<int>, std::vector<int>> parseFileContent(std::stringstream &file_content)
+struct LocationLists
 {
-    std::vector<int> left;
-    std::vector<int> right;
-    for (std::string str; std::getline(file_content, str);)
+    std::vector<uint32_t> left;
+    std::vector<uint32_t> right;
+};
+
+struct Reconciliation
+{
+    uint64_t distance = 0;
+    uint64_t similarity = 0;
+};
+
+/*
+ * SWAR digit parsing: eight input bytes are loaded at once, the digit run
+ * length comes from the first non-digit byte, and the digits are folded into
+ * a value with three multiply-shift steps instead of a per-character loop.
+ */
+constexpr uint64_t SWAR_ONES = 0x0101010101010101ull;
+
+uint32_t parseNumber(const char *&p, const char *end)
+{
+    uint64_t value = 0;
+    while (end - p >= 8)
     {
-        int left_v, right_v;
-        std::stringstream(str) >> left_v >> right_v;
-        left.push_back(left_v);
-        right.push_back(right_v);
+        uint64_t chunk;
+        std::memcpy(&chunk, p, 8);
+        uint64_t digits = chunk ^ (SWAR_ONES * '0');
+        uint64_t non_digit = ((digits + SWAR_ONES * 0x76) | digits) & (SWAR_ONES * 0x80);
+        int length = std::countr_zero(non_digit) / 8;
+        if (length == 0)
+            return value;
+
+        uint64_t packed = digits << (8 * (8 - length));
+        packed = ((packed & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+        packed = ((packed & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+        packed = ((packed & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32;
+
+        static constexpr std::array<uint64_t, 9> POW10 = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+        value = value * POW10[length] + packed;
+        p += length;
+        if (length < 8)
+            return value;
     }
-    return {left, right};
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        value = value * 10 + (*p - '0');
+    return value;
 }
 
-std::string part1(std::stringstream &file_content)
+LocationLists parseLists(std::stringstream &file_content)
 {
-    auto [left, right] = parseFileContent(file_content);
+    std::string_view content = file_content.view();
+    const char *p = content.data();
+    const char *end = p + content.size();
 
-    std::sort(left.begin(), left.end());
-    std::sort(right.begin(), right.end());
+    size_t line_count = std::count(content.begin(), content.end(), '\n') + 1;
+    LocationLists lists;
+    lists.left.resize(line_count);
+    lists.right.resize(line_count);
 
-    auto it_left = left.begin();
-    auto it_right = right.begin();
+    // Stays on the current line; returns false at its end
+    auto skipToDigit = [&]()
+    {
+        while (p < end && *p != '\n' && (*p < '0' || *p > '9'))
+            ++p;
+        return p < end && *p != '\n';
+    };
 
-    int sum_diff = 0;
+    // Two numbers per line, anything after them up to the newline is ignored,
+    // so count never exceeds line_count
+    size_t count = 0;
+    while (p < end)
+    {
+        if (skipToDigit())
+        {
+            uint32_t left = parseNumber(p, end);
+            if (skipToDigit())
+            {
+                lists.left[count] = left;
+                lists.right[count] = parseNumber(p, end);
+                ++count;
+            }
+        }
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+    lists.left.resize(count);
+    lists.right.resize(count);
+    return lists;
+}
 
-    for (; it_left != left.end(); ++it_left, ++it_right)
-        sum_diff += std::abs(*it_left - *it_right);
+/*
+ * LSD radix sort on bytes. Each pass splits the keys into chunks, one thread
+ * per chunk: histograms are built in parallel, prefixed in (digit, chunk)
+ * order and scattered in parallel, which keeps every pass stable. Passes over
+ * bytes above the largest key are skipped.
+ */
+void radixSort(std::vector<uint32_t> &keys)
+{
+    size_t n = keys.size();
+    if (n < 2)
+        return;
+
+    uint32_t max_key = *std::max_element(keys.begin(), keys.end());
+    size_t thread_count = std::clamp<size_t>(n / (1 << 16), 1, std::max(1u, std::thread::hardware_concurrency()));
+    size_t chunk = (n + thread_count - 1) / thread_count;
 
-    return std::to_string(sum_diff);
+    std::vector<uint32_t> buffer(n);
+    std::vector<std::array<size_t, 256>> offsets(thread_count);
+
+    for (int shift = 0; shift < 32 && (max_key >> shift) != 0; shift += 8)
+    {
+        auto runPhase = [&](auto &&phase)
+        {
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < thread_count; ++t)
+                workers.emplace_back(phase, t);
+            phase(0);
+            for (auto &worker : workers)
+                worker.join();
+        };
+
+        runPhase([&](size_t t)
+                 {
+            offsets[t].fill(0);
+            for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i)
+                ++offsets[t][(keys[i] >> shift) & 0xFF]; });
+
+        size_t position = 0;
+        for (int digit = 0; digit < 256; ++digit)
+            for (size_t t = 0; t < thread_count; ++t)
+            {
+                size_t bucket_size = offsets[t][digit];
+                offsets[t][digit] = position;
+                position += bucket_size;
+            }
+
+        runPhase([&](size_t t)
+                 {
+            for (size_t i = t * chunk; i < std::min(n, (t + 1) * chunk); ++i)
+                buffer[offsets[t][(keys[i] >> shift) & 0xFF]++] = keys[i]; });
+
+        keys.swap(buffer);
+    }
 }
 
-std::string part2(std::stringstream &file_content)
+/*
+ * Both answers from one pass over the sorted lists: distances pair up equal
+ * ranks, and a cursor over the right list counts the run matching each left
+ * value (reused while the left value repeats).
+ */
+Reconciliation reconcileLists(std::stringstream &file_content)
 {
-    auto [left, right] = parseFileContent(file_content);
+    LocationLists lists = parseLists(file_content);
+
+    std::thread sort_left([&]()
+                          { radixSort(lists.left); });
+    radixSort(lists.right);
+    sort_left.join();
 
-    std::unordered_map<int, int> count_map;
-    for (const auto v : right)
-        count_map[v]++;
+    const auto &left = lists.left;
+    const auto &right = lists.right;
 
-    int sum_count = 0;
-    for (const auto v : left)
-        sum_count += v * count_map[v];
+    Reconciliation result;
+    size_t cursor = 0;
+    uint64_t run_count = 0;
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        result.distance += left[i] > right[i] ? left[i] - right[i] : right[i] - left[i];
 
-    return std::to_string(sum_count);
+        if (i == 0 || left[i] != left[i - 1])
+        {
+            while (cursor < right.size() && right[cursor] < left[i])
+                ++cursor;
+            run_count = 0;
+            while (cursor < right.size() && right[cursor] == left[i])
+            {
+                ++cursor;
+                ++run_count;
+            }
+        }
+        result.similarity += (uint64_t)left[i] * run_count;
+    }
+    return result;
+}
+
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(reconcileLists(file_content).distance);
+}
+
+std::string part2(std::stringstream &file_content)
+{
+    return std::to_string(reconcileLists(file_content).similarity);
 }
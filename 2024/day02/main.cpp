@@ -11,6 +11,9 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
+#include <algorithm>
+#include <string_view>
+#include <thread>
 
 /*************
  * Setup code
@@ -97,76 +100,108 @@ int main(int argc, char const *argv[])
  **************************************/
 
 
-std::vector<int> parseLine(const std::string &line)
+/*
+ * A report is safe with at most K removals iff some subsequence missing at
+ * most K levels is strictly monotone with steps of 1 to 3. removals[i] is the
+ * fewest levels dropped before level i when i is kept, and it only depends on
+ * the K + 1 previous levels, so each trend is checked in one pass over a ring
+ * window without storing the report.
+ */
+class ReportChecker
 {
-    std::vector<int> numbers;
-    std::stringstream ss(line);
-    for (int number; ss >> number;)
-        numbers.push_back(number);
-
-    return numbers;
-}
+public:
+    explicit ReportChecker(int max_removals)
+        : max_removals(max_removals), window(max_removals + 1), levels(window), removals{std::vector<int>(window), std::vector<int>(window)}
+    {
+    }
 
-bool isSafeReport(const std::vector<int> &numbers, int skip = -1)
-{
-    int diff = 0;
-    int sz = numbers.size();
-    int prev = skip == 0 ? numbers[1] : numbers[0];
-    for (int i = skip == 0 ? 2 : 1; i < sz; i++)
+    // Consumes one line; returns -1 for a blank line, else whether it is safe
+    int checkReport(const char *&p, const char *end)
     {
-        if (skip == i)
-            continue;
+        int count = 0;
+        int best[2] = {0, 0}; // min of removals[i] - i per trend
+        while (p < end && *p != '\n')
+        {
+            if (*p < '0' || *p > '9')
+            {
+                ++p;
+                continue;
+            }
+            int level = 0;
+            for (; p < end && *p >= '0' && *p <= '9'; ++p)
+                level = level * 10 + (*p - '0');
 
-        int next = numbers[i];
-        int d = next - prev;
-        prev = next;
+            for (int trend = 0; trend < 2; ++trend)
+            {
+                int cost = count;
+                for (int back = 1; back <= std::min(count, window); ++back)
+                {
+                    int slot = (count - back) % window;
+                    int step = trend == 0 ? level - levels[slot] : levels[slot] - level;
+                    if (step >= 1 && step <= 3)
+                        cost = std::min(cost, removals[trend][slot] + back - 1);
+                }
+                removals[trend][count % window] = cost;
+                best[trend] = std::min(best[trend], cost - count);
+            }
+            levels[count % window] = level;
+            ++count;
+        }
+        if (p < end)
+            ++p;
 
-        if (d == 0)
-            return false;
+        if (count == 0)
+            return -1;
+        return std::min(best[0], best[1]) + count - 1 <= max_removals;
+    }
 
-        if ((d > 0 && diff < 0) || (d < 0 && diff > 0))
-            return false;
+private:
+    int max_removals;
+    int window;
+    std::vector<int> levels;
+    std::vector<int> removals[2];
+};
 
-        if (std::abs(d) > 3)
-            return false;
+int countSafeReports(std::stringstream &file_content, int max_removals)
+{
+    std::string_view content = file_content.view();
+    size_t thread_count = std::clamp<size_t>(content.size() / (1 << 16), 1, std::max(1u, std::thread::hardware_concurrency()));
 
-        diff = d;
+    // Chunk boundaries snapped to the start of a line
+    std::vector<size_t> bounds(thread_count + 1, content.size());
+    bounds[0] = 0;
+    for (size_t t = 1; t < thread_count; ++t)
+    {
+        size_t newline = content.find('\n', std::max(bounds[t - 1], t * content.size() / thread_count));
+        bounds[t] = newline == std::string_view::npos ? content.size() : newline + 1;
     }
 
-    return true;
+    std::vector<int> safe_counts(thread_count, 0);
+    auto worker = [&](size_t t)
+    {
+        ReportChecker checker(max_removals);
+        const char *p = content.data() + bounds[t];
+        const char *end = content.data() + bounds[t + 1];
+        while (p < end)
+            safe_counts[t] += checker.checkReport(p, end) == 1;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; ++t)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : workers)
+        thread.join();
+
+    return std::accumulate(safe_counts.begin(), safe_counts.end(), 0);
 }
 
-
 std::string part1(std::stringstream &file_content)
 {
-    int safe_reports{};
-
-    for (std::string line; std::getline(file_content, line);)
-    {
-        std::vector<int> numbers = parseLine(line);
-        safe_reports += isSafeReport(numbers, -1);
-    }
-
-    return std::to_string(safe_reports);
+    return std::to_string(countSafeReports(file_content, 0));
 }
 
 std::string part2(std::stringstream &file_content)
 {
-    int safe_reports{};
-
-    for (std::string line; std::getline(file_content, line);)
-    {
-        std::vector<int> numbers = parseLine(line);
-        int sz = numbers.size();
-        for (int i = -1; i < sz; ++i)
-        {
-            if (isSafeReport(numbers, i))
-            {
-                safe_reports++;
-                break;
-            }
-        }
-    }
-
-    return std::to_string(safe_reports);
-}
\ No newline at end of file
+    return std::to_string(countSafeReports(file_content, 1));
+}
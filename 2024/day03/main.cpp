@@ -12,6 +12,11 @@
 #include <climits>
 #include <cmath>
 #include <regex>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <thread>
 
 /*************
  * Setup code
@@ -97,132 +102,151 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-enum class ParseState
+/*
+ * Candidates are the 'm' and 'd' bytes, found eight at a time with SWAR byte
+ * compares (the lowest flagged byte is exact, later ones may be spurious and
+ * are rejected by validation). Each candidate is matched against the keywords
+ * with one masked 8-byte compare, then mul operands are read as 1 to 3 digits.
+ */
+constexpr uint64_t SWAR_ONES = 0x0101010101010101ull;
+constexpr uint64_t SWAR_HIGHS = 0x8080808080808080ull;
+
+constexpr uint64_t packWord(std::string_view word)
 {
-    NONE = -1,
-    NUM_LEFT = 0,
-    NUM_RIGHT = 1,
-    MULT = 2,
-    DO = 3,
-    DONT = 4
-};
+    uint64_t packed = 0;
+    for (size_t i = 0; i < word.size(); ++i)
+        packed |= (uint64_t)(unsigned char)word[i] << (8 * i);
+    return packed;
+}
+
+constexpr uint64_t MUL_WORD = packWord("mul(");
+constexpr uint64_t DO_WORD = packWord("do()");
+constexpr uint64_t DONT_WORD = packWord("don't()");
+constexpr uint64_t MASK_4 = 0xFFFFFFFFull;
+constexpr uint64_t MASK_7 = 0x00FFFFFFFFFFFFFFull;
+
+uint64_t loadWord(const char *p, const char *end)
+{
+    uint64_t word = 0;
+    std::memcpy(&word, p, std::min<size_t>(8, end - p));
+    return word;
+}
+
+uint64_t zeroBytes(uint64_t word)
+{
+    return (word - SWAR_ONES) & ~word & SWAR_HIGHS;
+}
 
-struct Trie
+// Scan result of one chunk, before knowing whether it starts enabled
+struct ChunkScan
 {
-    std::unordered_map<char, Trie> children;
-    ParseState val;
+    uint64_t total = 0;
+    uint64_t before_toggle = 0; // muls ahead of the first do()/don't()
+    uint64_t after_toggle = 0;  // enabled muls from the first toggle on
+    bool toggled = false;
+    bool enabled = true; // state at the end of the chunk, if toggled
 };
 
-Trie makeTrie()
+struct MemoryScan
 {
+    uint64_t total = 0;
+    uint64_t enabled = 0;
+};
 
-    std::vector<std::vector<std::pair<char, ParseState>>> tr = {{{'m', ParseState::NONE}, {'u', ParseState::NONE}, {'l', ParseState::NONE}, {'(', ParseState::NUM_LEFT}, {',', ParseState::NUM_RIGHT}, {')', ParseState::MULT}},
-                                                                {{'d', ParseState::NONE}, {'o', ParseState::NONE}, {'(', ParseState::NONE}, {')', ParseState::DO}},
-                                                                {{'d', ParseState::NONE}, {'o', ParseState::NONE}, {'n', ParseState::NONE}, {'\'', ParseState::NONE}, {'t', ParseState::NONE}, {'(', ParseState::NONE}, {')', ParseState::DONT}}};
-    Trie root{};
+bool readOperand(const char *&p, const char *end, uint64_t &value)
+{
+    const char *first = p;
+    value = 0;
+    for (; p < end && p - first < 3 && *p >= '0' && *p <= '9'; ++p)
+        value = value * 10 + (*p - '0');
+    return p != first;
+}
 
-    for (auto &v : tr)
+void scanCandidate(const char *p, const char *end, ChunkScan &scan)
+{
+    uint64_t word = loadWord(p, end);
+    if ((word & MASK_4) == MUL_WORD)
     {
-        Trie *current = &root;
-        for (auto &[c, val] : v)
-        {
-            if (current->children.find(c) == current->children.end())
-                current->children[c] = Trie{};
-            current = &current->children[c];
-            current->val = val;
-        }
+        const char *q = p + 4;
+        uint64_t left, right;
+        if (!readOperand(q, end, left) || q == end || *q++ != ',' || !readOperand(q, end, right) || q == end || *q != ')')
+            return;
+        uint64_t product = left * right;
+        scan.total += product;
+        if (!scan.toggled)
+            scan.before_toggle += product;
+        else if (scan.enabled)
+            scan.after_toggle += product;
+    }
+    else if ((word & MASK_4) == DO_WORD || (word & MASK_7) == DONT_WORD)
+    {
+        scan.toggled = true;
+        scan.enabled = (word & MASK_4) == DO_WORD;
     }
-
-    return root;
 }
 
-std::string part1(std::stringstream &file_content)
+// Owns the candidates starting in [begin, end); matches may read up to limit
+ChunkScan scanChunk(const char *begin, const char *end, const char *limit)
 {
-    std::string str = file_content.str();
-    int result{};
-
-    Trie root = makeTrie();
-
-    int left{};
-    int right{};
-
-    Trie *current = &root;
-    for (char c : str)
+    ChunkScan scan;
+    const char *p = begin;
+    for (; end - p >= 8; p += 8)
     {
-
-        if (current->val == ParseState::NUM_LEFT && std::isdigit(c))
-        {
-            left = left * 10 + (c - '0');
-            continue;
-        }
-        else if (current->val == ParseState::NUM_RIGHT && std::isdigit(c))
-        {
-            right = right * 10 + (c - '0');
-            continue;
-        }
-        else if (current->children.count(c))
-        {
-            current = &current->children[c];
-            continue;
-        }
-
-        if (current->val == ParseState::MULT)
-            result += left * right;
-
-        current = &root, left = 0, right = 0;
-        if (current->children.count(c))
-            current = &current->children[c];
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        uint64_t hits = zeroBytes(word ^ (SWAR_ONES * 'm')) | zeroBytes(word ^ (SWAR_ONES * 'd'));
+        for (; hits; hits &= hits - 1)
+            scanCandidate(p + std::countr_zero(hits) / 8, limit, scan);
     }
-
-    return std::to_string(result);
+    for (; p < end; ++p)
+        if (*p == 'm' || *p == 'd')
+            scanCandidate(p, limit, scan);
+    return scan;
 }
 
-std::string part2(std::stringstream &file_content)
+/*
+ * Chunks are scanned in parallel without knowing their starting state, then
+ * merged left to right: the prefix of the enable state decides whether each
+ * chunk's muls before its first toggle count.
+ */
+MemoryScan scanMemory(std::stringstream &file_content)
 {
+    std::string_view content = file_content.view();
+    const char *data = content.data();
+    const char *limit = data + content.size();
+    size_t thread_count = std::clamp<size_t>(content.size() / (1 << 20), 1, std::max(1u, std::thread::hardware_concurrency()));
 
-    std::string str = file_content.str();
-    int result{};
-
-    Trie root = makeTrie();
-
-    bool pdo = true;
-    int left{};
-    int right{};
-
-    Trie *current = &root;
-    for (char c : str)
+    std::vector<ChunkScan> scans(thread_count);
+    auto worker = [&](size_t t)
     {
-
-        if (current->val == ParseState::NUM_LEFT && std::isdigit(c))
-        {
-            left = left * 10 + (c - '0');
-            continue;
-        }
-        else if (current->val == ParseState::NUM_RIGHT && std::isdigit(c))
-        {
-            right = right * 10 + (c - '0');
-            continue;
-        }
-        else if (current->children.count(c))
-        {
-            current = &current->children[c];
-            continue;
-        }
-
-        if (current->val == ParseState::MULT && pdo)
-        {
-            result += left * right;
-            current = &root, left = 0, right = 0;
-        }
-        else if (current->val == ParseState::DO)
-            pdo = true;
-        else if (current->val == ParseState::DONT)
-            pdo = false;
-
-        current = &root, left = 0, right = 0;
-        if (current->children.count(c))
-            current = &current->children[c];
+        scans[t] = scanChunk(data + t * content.size() / thread_count, data + (t + 1) * content.size() / thread_count, limit);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; ++t)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : workers)
+        thread.join();
+
+    MemoryScan result;
+    bool enabled = true;
+    for (const auto &scan : scans)
+    {
+        result.total += scan.total;
+        result.enabled += (enabled ? scan.before_toggle : 0) + scan.after_toggle;
+        if (scan.toggled)
+            enabled = scan.enabled;
     }
+    return result;
+}
 
-    return std::to_string(result);
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(scanMemory(file_content).total);
+}
+
+std::string part2(std::stringstream &file_content)
+{
+    return std::to_string(scanMemory(file_content).enabled);
 }
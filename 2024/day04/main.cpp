@@ -12,6 +12,12 @@
 #include <climits>
 #include <cmath>
 #include <array>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+#include <tuple>
 
 /*************
  * Setup code
@@ -97,80 +103,215 @@ int main(int argc, char const *argv[])
  *              Solutions
  **************************************/
 
-bool searchDir(const std::vector<std::string> &grid, int x, int y, int width, int height, std::pair<int, int> dir)
+/*
+ * One bit-plane per letter, 64 columns per word. A pattern is a set of
+ * (row, column, letter) offsets from an anchor; a row of anchors matches
+ * wherever the AND of the correspondingly shifted plane rows is set, so 64
+ * positions are tested per word operation.
+ */
+struct PatternCell
 {
+    int dy, dx;
+    char letter;
+};
+
+using pattern_t = std::vector<PatternCell>;
 
-    const std::string str_search = "XMAS";
-    for (int i = 0; i < 4; i++)
+class LetterPlanes
+{
+public:
+    explicit LetterPlanes(std::stringstream &file_content)
     {
-        int new_x = x + i * dir.first;
-        int new_y = y + i * dir.second;
-        if (new_x < 0 || new_x >= width || new_y < 0 || new_y >= height)
+        std::vector<std::string_view> lines;
+        std::string_view content = file_content.view();
+        for (size_t start = 0; start < content.size();)
         {
-            return false;
+            size_t end = std::min(content.find('\n', start), content.size());
+            if (end > start)
+                lines.push_back(content.substr(start, end - start));
+            start = end + 1;
         }
-        if (grid[new_y][new_x] != str_search[i])
-        {
-            return false;
-        }
-    }
-    return true;
-}
 
+        height = lines.size();
+        for (auto line : lines)
+            width = std::max<int>(width, line.size());
+        words = (width + 63) / 64;
 
-std::string part1(std::stringstream &file_content)
-{
-    std::vector<std::string> grid;
-    for (std::string line; std::getline(file_content, line);)
+        plane_index.fill(-1);
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < (int)lines[y].size(); ++x)
+            {
+                unsigned char letter = lines[y][x];
+                if (plane_index[letter] < 0)
+                {
+                    plane_index[letter] = planes.size();
+                    planes.emplace_back((size_t)height * words, 0);
+                }
+                planes[plane_index[letter]][(size_t)y * words + x / 64] |= 1ull << (x % 64);
+            }
+    }
+
+    long long countPattern(const pattern_t &pattern) const
     {
-        grid.push_back(line);
+        for (const auto &cell : pattern)
+            if (plane_index[(unsigned char)cell.letter] < 0)
+                return 0;
+
+        size_t thread_count = std::clamp<size_t>((size_t)height * words / 1024, 1, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<long long> counts(thread_count, 0);
+        auto worker = [&](size_t t)
+        {
+            for (int y = t * height / thread_count; y < (int)((t + 1) * height / thread_count); ++y)
+                counts[t] += countRow(pattern, y);
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < thread_count; ++t)
+            workers.emplace_back(worker, t);
+        worker(0);
+        for (auto &thread : workers)
+            thread.join();
+
+        return std::accumulate(counts.begin(), counts.end(), 0ll);
     }
 
-    int width = grid[0].size();
-    int height = grid.size();
+private:
+    int width = 0;
+    int height = 0;
+    int words = 0;
+    std::array<int, 256> plane_index;
+    std::vector<std::vector<uint64_t>> planes;
 
-    const std::array<std::pair<int, int>, 8> dirs = {
-        {{1, 0}, {0, 1}, {1, 1}, {1, -1}, {-1, 0}, {0, -1}, {-1, -1}, {-1, 1}}};
+    // Bits for columns [start, start + 64) of a plane row, zero outside the grid
+    uint64_t window(const uint64_t *row, long start) const
+    {
+        if (start <= -64 || start >= (long)words * 64)
+            return 0;
+        long q = start >= 0 ? start / 64 : -((63 - start) / 64);
+        int shift = start - q * 64;
+        uint64_t low = q >= 0 ? row[q] : 0;
+        if (shift == 0)
+            return low;
+        uint64_t high = q + 1 < words ? row[q + 1] : 0;
+        return (low >> shift) | (high << (64 - shift));
+    }
 
-    int total_xmas{};
-    for (int y = 0; y < height; y++)
+    long long countRow(const pattern_t &pattern, int y) const
     {
-        for (int x = 0; x < width; x++)
+        for (const auto &cell : pattern)
+            if (y + cell.dy < 0 || y + cell.dy >= height)
+                return 0;
+
+        long long count = 0;
+        for (int w = 0; w < words; ++w)
         {
-            for (const auto &dir : dirs)
+            int valid_columns = std::min(64, width - w * 64);
+            uint64_t matches = valid_columns == 64 ? ~0ull : (1ull << valid_columns) - 1;
+            for (const auto &cell : pattern)
             {
-                total_xmas += searchDir(grid, x, y, width, height, dir);
+                const uint64_t *row = planes[plane_index[(unsigned char)cell.letter]].data() + (size_t)(y + cell.dy) * words;
+                matches &= window(row, (long)w * 64 + cell.dx);
             }
+            count += std::popcount(matches);
         }
+        return count;
     }
+};
 
-    return std::to_string(total_xmas);
+pattern_t linePattern(std::string_view word, int dx, int dy)
+{
+    pattern_t pattern;
+    for (int i = 0; i < (int)word.size(); ++i)
+        pattern.push_back({i * dy, i * dx, word[i]});
+    return pattern;
 }
 
-std::string part2(std::stringstream &file_content)
+/*
+ * Orientations of a palindromic word cover the same cells, so patterns are
+ * compared as sets: translated to a zero minimum offset and sorted, with
+ * duplicates counted once.
+ */
+pattern_t canonicalPattern(pattern_t pattern)
 {
-
-    std::vector<std::string> grid;
-    for (std::string line; std::getline(file_content, line);)
+    int min_dy = 0, min_dx = 0;
+    for (const auto &cell : pattern)
     {
-        grid.push_back(line);
+        min_dy = std::min(min_dy, cell.dy);
+        min_dx = std::min(min_dx, cell.dx);
     }
+    for (auto &cell : pattern)
+    {
+        cell.dy -= min_dy;
+        cell.dx -= min_dx;
+    }
+    std::sort(pattern.begin(), pattern.end(), [](const PatternCell &a, const PatternCell &b)
+              { return std::tie(a.dy, a.dx, a.letter) < std::tie(b.dy, b.dx, b.letter); });
+    return pattern;
+}
 
-    int width = grid[0].size();
-    int height = grid.size();
+long long countDistinctPatterns(const LetterPlanes &planes, const std::vector<pattern_t> &orientations)
+{
+    auto sameCell = [](const PatternCell &a, const PatternCell &b)
+    { return a.dy == b.dy && a.dx == b.dx && a.letter == b.letter; };
 
-    int total_xmas{};
-    for (int y = 1; y < height - 1; y++)
+    std::vector<pattern_t> seen;
+    long long total = 0;
+    for (const auto &orientation : orientations)
     {
-        for (int x = 1; x < width - 1; x++)
-        {
-            if (grid[y][x] != 'A')
-                continue;
+        pattern_t pattern = canonicalPattern(orientation);
+        bool duplicate = std::any_of(seen.begin(), seen.end(), [&](const pattern_t &other)
+                                     { return std::equal(pattern.begin(), pattern.end(), other.begin(), other.end(), sameCell); });
+        if (duplicate)
+            continue;
+        total += planes.countPattern(pattern);
+        seen.push_back(std::move(pattern));
+    }
+    return total;
+}
+
+long long countWord(const LetterPlanes &planes, std::string_view word)
+{
+    const std::array<std::pair<int, int>, 8> dirs = {
+        {{1, 0}, {0, 1}, {1, 1}, {1, -1}, {-1, 0}, {0, -1}, {-1, -1}, {-1, 1}}};
+
+    std::vector<pattern_t> orientations;
+    for (const auto &[dx, dy] : dirs)
+        orientations.push_back(linePattern(word, dx, dy));
+    return countDistinctPatterns(planes, orientations);
+}
 
-            total_xmas += ((('M' ^ 'S') == (grid[y - 1][x - 1] ^ grid[y + 1][x + 1])) && (('M' ^ 'S') == (grid[y - 1][x + 1] ^ grid[y + 1][x - 1])));
+// Odd-length word read along both diagonals of a square, in either direction
+long long countCross(const LetterPlanes &planes, std::string_view word)
+{
+    int half = word.size() / 2;
+    std::vector<pattern_t> orientations;
+    for (int main_sign : {1, -1})
+        for (int anti_sign : {1, -1})
+        {
+            pattern_t pattern;
+            for (int i = 0; i < (int)word.size(); ++i)
+            {
+                int offset = (i - half) * main_sign;
+                pattern.push_back({offset, offset, word[i]});
+            }
+            for (int i = 0; i < (int)word.size(); ++i)
+            {
+                int offset = (i - half) * anti_sign;
+                pattern.push_back({-offset, offset, word[i]});
+            }
+            orientations.push_back(std::move(pattern));
         }
-    }
+    return countDistinctPatterns(planes, orientations);
+}
 
-    return std::to_string(total_xmas);
+std::string part1(std::stringstream &file_content)
+{
+    LetterPlanes planes(file_content);
+    return std::to_string(countWord(planes, "XMAS"));
 }
 
+std::string part2(std::stringstream &file_content)
+{
+    LetterPlanes planes(file_content);
+    return std::to_string(countCross(planes, "MAS"));
+}
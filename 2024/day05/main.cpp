@@ -11,7 +11,10 @@
 #include <cstring>
 #include <climits>
 #include <cmath>
-#include <bitset>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <thread>
 
 /*************
  * Setup code
@@ -99,11 +102,61 @@ int main(int argc, char const *argv[])
 
 using update_t = std::vector<int>;
 using updates_t = std::vector<update_t>;
-using rules_t = std::bitset<10000>;
 
-std::pair<rules_t, updates_t> parseInput(std::stringstream &file_content)
+/*
+ * Page ids are interned to dense indices in order of appearance, and rule
+ * "a|b" sets bit b in row a of a square bit matrix.
+ */
+class PrecedenceRules
 {
-    rules_t rules;
+public:
+    int intern(int page)
+    {
+        if (page >= (int)page_index.size())
+            page_index.resize(page + 1, -1);
+        if (page_index[page] < 0)
+        {
+            page_index[page] = page_count++;
+            pending.emplace_back();
+        }
+        return page_index[page];
+    }
+
+    void addRule(int before, int after)
+    {
+        int from = intern(before), to = intern(after);
+        pending[from].push_back(to);
+    }
+
+    // Builds the bit matrix once all pages are known
+    void finalize()
+    {
+        words = (page_count + 63) / 64;
+        matrix.assign((size_t)page_count * words, 0);
+        for (int from = 0; from < page_count; ++from)
+            for (int to : pending[from])
+                matrix[(size_t)from * words + to / 64] |= 1ull << (to % 64);
+        pending.clear();
+    }
+
+    int index(int page) const { return page < (int)page_index.size() ? page_index[page] : -1; }
+
+    bool precedes(int from, int to) const
+    {
+        return from >= 0 && to >= 0 && (matrix[(size_t)from * words + to / 64] >> (to % 64)) & 1;
+    }
+
+private:
+    std::vector<int> page_index;
+    int page_count = 0;
+    int words = 0;
+    std::vector<uint64_t> matrix;
+    std::vector<std::vector<int>> pending;
+};
+
+std::pair<PrecedenceRules, updates_t> parseInput(std::stringstream &file_content)
+{
+    PrecedenceRules rules;
     updates_t updates;
 
     for (std::string line; std::getline(file_content, line);)
@@ -113,60 +166,124 @@ std::pair<rules_t, updates_t> parseInput(std::stringstream &file_content)
 
         int a, b;
         sscanf(line.c_str(), "%d|%d", &a, &b);
-        rules.set(a * 100 + b);
+        rules.addRule(a, b);
     }
+    rules.finalize();
 
     for (std::string line; std::getline(file_content, line);)
     {
-        std::stringstream ss(line);
+        if (line.empty())
+            continue;
         updates.emplace_back();
-        for (std::string number; std::getline(ss, number, ',');)
-            updates.back().push_back(std::stoi(number));
+        int number = 0;
+        for (char c : line)
+        {
+            if (c == ',')
+            {
+                updates.back().push_back(number);
+                number = 0;
+            }
+            else if (c >= '0' && c <= '9')
+                number = number * 10 + (c - '0');
+        }
+        updates.back().push_back(number);
     }
 
-    return {rules, updates};
+    return {std::move(rules), updates};
 }
 
-bool updateIsOk(const rules_t &rule_container, const update_t &update)
+struct UpdateSums
+{
+    long long ordered = 0;
+    long long corrected = 0;
+};
+
+/*
+ * Per update, predecessors[i] masks the positions j whose page must come
+ * before page i. The update is ordered iff no mask reaches past its own
+ * position, and in the corrected order the median is the page with exactly
+ * size / 2 predecessors, so no sort is needed.
+ */
+void checkUpdate(const PrecedenceRules &rules, const update_t &update, std::vector<int> &indices, std::vector<uint64_t> &predecessors, UpdateSums &sums)
 {
-    int sz = update.size();
-    for (int i = 1; i < sz; i++)
+    int size = update.size();
+    int words = (size + 63) / 64;
+    indices.resize(size);
+    for (int i = 0; i < size; ++i)
+        indices[i] = rules.index(update[i]);
+
+    predecessors.assign((size_t)size * words, 0);
+    bool ordered = true;
+    for (int i = 0; i < size; ++i)
     {
-        int key = update[i - 1] * 100 + update[i];
-        if (!rule_container.test(key))
-            return false;
-    }
+        uint64_t *row = predecessors.data() + (size_t)i * words;
+        for (int j = 0; j < size; ++j)
+            if (rules.precedes(indices[j], indices[i]))
+                row[j / 64] |= 1ull << (j % 64);
 
-    return true;
-}
+        // Any predecessor at a position >= i breaks the order
+        for (int w = i / 64; w < words && ordered; ++w)
+        {
+            uint64_t late = w == i / 64 ? row[w] >> (i % 64) : row[w];
+            ordered = late == 0;
+        }
+    }
 
-std::string part1(std::stringstream &file_content)
-{
-    auto [rule_container, updates] = parseInput(file_content);
-    int mid_count{};
-    for (const auto &update : updates)
+    if (ordered)
     {
-        if (updateIsOk(rule_container, update))
-            mid_count += update[update.size() / 2];
+        sums.ordered += update[size / 2];
+        return;
     }
 
-    return std::to_string(mid_count);
+    for (int i = 0; i < size; ++i)
+    {
+        int count = 0;
+        for (int w = 0; w < words; ++w)
+            count += std::popcount(predecessors[(size_t)i * words + w]);
+        if (count == size / 2)
+        {
+            sums.corrected += update[i];
+            return;
+        }
+    }
 }
 
-std::string part2(std::stringstream &file_content)
+UpdateSums sumMedians(std::stringstream &file_content)
 {
-    auto [rule_container, updates] = parseInput(file_content);
-    int mid_count{};
-    for (auto &update : updates)
+    auto [rules, updates] = parseInput(file_content);
+
+    size_t thread_count = std::clamp<size_t>(updates.size() / 256, 1, std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<UpdateSums> partial(thread_count);
+    auto worker = [&](size_t t)
     {
-        if (updateIsOk(rule_container, update))
-            continue;
+        std::vector<int> indices;
+        std::vector<uint64_t> predecessors;
+        for (size_t u = t * updates.size() / thread_count; u < (t + 1) * updates.size() / thread_count; ++u)
+            checkUpdate(rules, updates[u], indices, predecessors, partial[t]);
+    };
 
-        std::sort(update.begin(), update.end(), [&](int a, int b)
-                  { return rule_container.test(a * 100 + b); });
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; ++t)
+        workers.emplace_back(worker, t);
+    worker(0);
+    for (auto &thread : workers)
+        thread.join();
 
-        mid_count += update[update.size() / 2];
+    UpdateSums sums;
+    for (const auto &part : partial)
+    {
+        sums.ordered += part.ordered;
+        sums.corrected += part.corrected;
     }
+    return sums;
+}
+
+std::string part1(std::stringstream &file_content)
+{
+    return std::to_string(sumMedians(file_content).ordered);
+}
 
-    return std::to_string(mid_count);
-}
\ No newline at end of file
+std::string part2(std::stringstream &file_content)
+{
+    return std::to_string(sumMedians(file_content).corrected);
+}